@@ -8,6 +8,8 @@
 #include <clang/AST/RecordLayout.h>
 
 #include <algorithm>
+#include <utility>
+#include <vector>
 
 #include "BlinkGCPluginOptions.h"
 #include "Config.h"
@@ -17,6 +19,7 @@
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/ASTMatchers/ASTMatchers.h"
 #include "clang/ASTMatchers/ASTMatchersMacros.h"
+#include "llvm/Support/TimeProfiler.h"
 
 using namespace clang::ast_matchers;
 
@@ -59,10 +62,36 @@ TypeMatcher TraceableType() {
                hasCanonicalType(arrayType(hasElementType(has_gc_base))));
 }
 
-class UniquePtrGarbageCollectedMatcher : public MatchFinder::MatchCallback {
+class DeferredMatchCallback;
+
+// The matches found by the traversal of the translation unit, in the order
+// they were found.
+using MatchQueue =
+    std::vector<std::pair<DeferredMatchCallback*, BoundNodes>>;
+
+// Base class of the bad pattern checks. The matches of the traversal are
+// queued, and reported once the records it collects have been checked.
+class DeferredMatchCallback : public MatchFinder::MatchCallback {
+ public:
+  explicit DeferredMatchCallback(MatchQueue& queue) : queue_(queue) {}
+
+  void run(const MatchFinder::MatchResult& result) final {
+    // The MatchFinder times the matchers only for the TimerGroup.
+    llvm::TimeTraceScope TimeScope(getID());
+    queue_.emplace_back(this, result.Nodes);
+  }
+
+  virtual void Report(const MatchFinder::MatchResult& result) = 0;
+
+ private:
+  MatchQueue& queue_;
+};
+
+class UniquePtrGarbageCollectedMatcher : public DeferredMatchCallback {
  public:
-  explicit UniquePtrGarbageCollectedMatcher(DiagnosticsReporter& diagnostics)
-      : diagnostics_(diagnostics) {}
+  UniquePtrGarbageCollectedMatcher(MatchQueue& queue,
+                                   DiagnosticsReporter& diagnostics)
+      : DeferredMatchCallback(queue), diagnostics_(diagnostics) {}
 
   void Register(MatchFinder& match_finder) {
     // Matches any application of make_unique where the template argument is
@@ -78,7 +107,11 @@ class UniquePtrGarbageCollectedMatcher : public MatchFinder::MatchCallback {
     match_finder.addDynamicMatcher(make_unique_matcher, this);
   }
 
-  void run(const MatchFinder::MatchResult& result) override {
+  llvm::StringRef getID() const override {
+    return "UniquePtrGarbageCollectedMatcher";
+  }
+
+  void Report(const MatchFinder::MatchResult& result) override {
     auto* bad_use = result.Nodes.getNodeAs<clang::Expr>("bad");
     auto* bad_function = result.Nodes.getNodeAs<clang::FunctionDecl>("badfunc");
     auto* gc_type = result.Nodes.getNodeAs<clang::CXXRecordDecl>("gctype");
@@ -101,11 +134,14 @@ bool IsOnStack(const clang::Decl* decl, RecordCache& record_cache) {
   return record_cache.Lookup(parent_decl)->IsStackAllocated();
 }
 
-class OptionalOrRawPtrToGCedMatcher : public MatchFinder::MatchCallback {
+class OptionalOrRawPtrToGCedMatcher : public DeferredMatchCallback {
  public:
-  OptionalOrRawPtrToGCedMatcher(DiagnosticsReporter& diagnostics,
+  OptionalOrRawPtrToGCedMatcher(MatchQueue& queue,
+                                DiagnosticsReporter& diagnostics,
                                 RecordCache& record_cache)
-      : diagnostics_(diagnostics), record_cache_(record_cache) {}
+      : DeferredMatchCallback(queue),
+        diagnostics_(diagnostics),
+        record_cache_(record_cache) {}
 
   void Register(MatchFinder& match_finder) {
     // Matches fields and new-expressions of type std::optional or
@@ -127,7 +163,11 @@ class OptionalOrRawPtrToGCedMatcher : public MatchFinder::MatchCallback {
     match_finder.addDynamicMatcher(optional_new_expression, this);
   }
 
-  void run(const MatchFinder::MatchResult& result) override {
+  llvm::StringRef getID() const override {
+    return "OptionalOrRawPtrToGCedMatcher";
+  }
+
+  void Report(const MatchFinder::MatchResult& result) override {
     auto* type = result.Nodes.getNodeAs<clang::CXXRecordDecl>("type");
     bool is_optional = (type->getName() == "optional");
     auto* arg_type = result.Nodes.getNodeAs<clang::CXXRecordDecl>("gctype");
@@ -168,11 +208,14 @@ class OptionalOrRawPtrToGCedMatcher : public MatchFinder::MatchCallback {
   RecordCache& record_cache_;
 };
 
-class OptionalMemberMatcher : public MatchFinder::MatchCallback {
+class OptionalMemberMatcher : public DeferredMatchCallback {
  public:
-  OptionalMemberMatcher(DiagnosticsReporter& diagnostics,
+  OptionalMemberMatcher(MatchQueue& queue,
+                        DiagnosticsReporter& diagnostics,
                         RecordCache& record_cache)
-      : diagnostics_(diagnostics), record_cache_(record_cache) {}
+      : DeferredMatchCallback(queue),
+        diagnostics_(diagnostics),
+        record_cache_(record_cache) {}
 
   void Register(MatchFinder& match_finder) {
     // Matches fields and new-expressions of type std::optional or
@@ -192,7 +235,9 @@ class OptionalMemberMatcher : public MatchFinder::MatchCallback {
     match_finder.addDynamicMatcher(optional_new_expression, this);
   }
 
-  void run(const MatchFinder::MatchResult& result) override {
+  llvm::StringRef getID() const override { return "OptionalMemberMatcher"; }
+
+  void Report(const MatchFinder::MatchResult& result) override {
     auto* type = result.Nodes.getNodeAs<clang::CXXRecordDecl>("type");
     auto* member = result.Nodes.getNodeAs<clang::CXXRecordDecl>("member");
     if (auto* bad_decl = result.Nodes.getNodeAs<clang::Decl>("bad_decl")) {
@@ -213,11 +258,14 @@ class OptionalMemberMatcher : public MatchFinder::MatchCallback {
   RecordCache& record_cache_;
 };
 
-class CollectionOfGarbageCollectedMatcher : public MatchFinder::MatchCallback {
+class CollectionOfGarbageCollectedMatcher : public DeferredMatchCallback {
  public:
-  explicit CollectionOfGarbageCollectedMatcher(DiagnosticsReporter& diagnostics,
-                                               RecordCache& record_cache)
-      : diagnostics_(diagnostics), record_cache_(record_cache) {}
+  CollectionOfGarbageCollectedMatcher(MatchQueue& queue,
+                                      DiagnosticsReporter& diagnostics,
+                                      RecordCache& record_cache)
+      : DeferredMatchCallback(queue),
+        diagnostics_(diagnostics),
+        record_cache_(record_cache) {}
 
   void Register(MatchFinder& match_finder) {
     auto gced_ptr_or_ref =
@@ -268,7 +316,11 @@ class CollectionOfGarbageCollectedMatcher : public MatchFinder::MatchCallback {
     match_finder.addDynamicMatcher(collection_new_expression, this);
   }
 
-  void run(const MatchFinder::MatchResult& result) override {
+  llvm::StringRef getID() const override {
+    return "CollectionOfGarbageCollectedMatcher";
+  }
+
+  void Report(const MatchFinder::MatchResult& result) override {
     auto* collection =
         result.Nodes.getNodeAs<clang::CXXRecordDecl>("collection");
     auto* gc_type = result.Nodes.getNodeAs<clang::CXXRecordDecl>("gctype");
@@ -345,10 +397,11 @@ AST_MATCHER_P(clang::TemplateArgument,
 // an `absl::variant` changes while the object is concurrently being marked,
 // Oilpan might fail to find a matching pair of element type and reference.
 // This in turn can lead to UAFs and other memory corruptions.
-class VariantGarbageCollectedMatcher : public MatchFinder::MatchCallback {
+class VariantGarbageCollectedMatcher : public DeferredMatchCallback {
  public:
-  explicit VariantGarbageCollectedMatcher(DiagnosticsReporter& diagnostics)
-      : diagnostics_(diagnostics) {}
+  VariantGarbageCollectedMatcher(MatchQueue& queue,
+                                 DiagnosticsReporter& diagnostics)
+      : DeferredMatchCallback(queue), diagnostics_(diagnostics) {}
 
   void Register(MatchFinder& match_finder) {
     // Matches any constructed absl::variant where a template argument is
@@ -365,7 +418,11 @@ class VariantGarbageCollectedMatcher : public MatchFinder::MatchCallback {
     match_finder.addDynamicMatcher(variant_construction, this);
   }
 
-  void run(const MatchFinder::MatchResult& result) override {
+  llvm::StringRef getID() const override {
+    return "VariantGarbageCollectedMatcher";
+  }
+
+  void Report(const MatchFinder::MatchResult& result) override {
     auto* bad_use = result.Nodes.getNodeAs<clang::Expr>("bad");
     auto* variant = result.Nodes.getNodeAs<clang::CXXRecordDecl>("variant");
     auto* gc_type = result.Nodes.getNodeAs<clang::CXXRecordDecl>("gctype");
@@ -376,10 +433,10 @@ class VariantGarbageCollectedMatcher : public MatchFinder::MatchCallback {
   DiagnosticsReporter& diagnostics_;
 };
 
-class MemberOnStackMatcher : public MatchFinder::MatchCallback {
+class MemberOnStackMatcher : public DeferredMatchCallback {
  public:
-  explicit MemberOnStackMatcher(DiagnosticsReporter& diagnostics)
-      : diagnostics_(diagnostics) {}
+  MemberOnStackMatcher(MatchQueue& queue, DiagnosticsReporter& diagnostics)
+      : DeferredMatchCallback(queue), diagnostics_(diagnostics) {}
 
   void Register(MatchFinder& match_finder) {
     auto class_member_variable_matcher =
@@ -387,7 +444,9 @@ class MemberOnStackMatcher : public MatchFinder::MatchCallback {
     match_finder.addDynamicMatcher(class_member_variable_matcher, this);
   }
 
-  void run(const MatchFinder::MatchResult& result) override {
+  llvm::StringRef getID() const override { return "MemberOnStackMatcher"; }
+
+  void Report(const MatchFinder::MatchResult& result) override {
     auto* member = result.Nodes.getNodeAs<clang::VarDecl>("var");
     if (Config::IsIgnoreAnnotated(member)) {
       return;
@@ -399,10 +458,10 @@ class MemberOnStackMatcher : public MatchFinder::MatchCallback {
   DiagnosticsReporter& diagnostics_;
 };
 
-class WeakPtrToGCedMatcher : public MatchFinder::MatchCallback {
+class WeakPtrToGCedMatcher : public DeferredMatchCallback {
  public:
-  explicit WeakPtrToGCedMatcher(DiagnosticsReporter& diagnostics)
-      : diagnostics_(diagnostics) {}
+  WeakPtrToGCedMatcher(MatchQueue& queue, DiagnosticsReporter& diagnostics)
+      : DeferredMatchCallback(queue), diagnostics_(diagnostics) {}
 
   void Register(MatchFinder& match_finder) {
     // Matches declarations of type base::WeakPtr and base::WeakPtrFactory
@@ -422,7 +481,9 @@ class WeakPtrToGCedMatcher : public MatchFinder::MatchCallback {
     match_finder.addDynamicMatcher(weak_ptr_new_expression, this);
   }
 
-  void run(const MatchFinder::MatchResult& result) override {
+  llvm::StringRef getID() const override { return "WeakPtrToGCedMatcher"; }
+
+  void Report(const MatchFinder::MatchResult& result) override {
     auto* decl = result.Nodes.getNodeAs<clang::Decl>("bad_decl");
     if (Config::IsIgnoreAnnotated(decl)) {
       return;
@@ -494,11 +555,14 @@ size_t RequiredSizeForFields(const clang::ASTContext& context,
   return current_size;
 }
 
-class PaddingInGCedMatcher : public MatchFinder::MatchCallback {
+class PaddingInGCedMatcher : public DeferredMatchCallback {
  public:
-  PaddingInGCedMatcher(clang::ASTContext& context,
+  PaddingInGCedMatcher(MatchQueue& queue,
+                       clang::ASTContext& context,
                        DiagnosticsReporter& diagnostics)
-      : context_(context), diagnostics_(diagnostics) {}
+      : DeferredMatchCallback(queue),
+        context_(context),
+        diagnostics_(diagnostics) {}
 
   void Register(MatchFinder& match_finder) {
     auto member_field_matcher =
@@ -508,7 +572,9 @@ class PaddingInGCedMatcher : public MatchFinder::MatchCallback {
     match_finder.addMatcher(member_field_matcher, this);
   }
 
-  void run(const MatchFinder::MatchResult& result) override {
+  llvm::StringRef getID() const override { return "PaddingInGCedMatcher"; }
+
+  void Report(const MatchFinder::MatchResult& result) override {
     auto* class_decl = result.Nodes.getNodeAs<clang::RecordDecl>("record");
     if (class_decl->isDependentType() || class_decl->isUnion()) {
       return;
@@ -573,10 +639,10 @@ class PaddingInGCedMatcher : public MatchFinder::MatchCallback {
   DiagnosticsReporter& diagnostics_;
 };
 
-class GCedVarOrField : public MatchFinder::MatchCallback {
+class GCedVarOrField : public DeferredMatchCallback {
  public:
-  explicit GCedVarOrField(DiagnosticsReporter& diagnostics)
-      : diagnostics_(diagnostics) {}
+  GCedVarOrField(MatchQueue& queue, DiagnosticsReporter& diagnostics)
+      : DeferredMatchCallback(queue), diagnostics_(diagnostics) {}
 
   void Register(MatchFinder& match_finder) {
     auto gced_field =
@@ -598,7 +664,9 @@ class GCedVarOrField : public MatchFinder::MatchCallback {
     match_finder.addDynamicMatcher(gced_var, this);
   }
 
-  void run(const MatchFinder::MatchResult& result) override {
+  llvm::StringRef getID() const override { return "GCedVarOrField"; }
+
+  void Report(const MatchFinder::MatchResult& result) override {
     const auto* gctype = result.Nodes.getNodeAs<clang::CXXRecordDecl>("gctype");
     assert(gctype);
     if (Config::IsGCCollection(gctype->getName())) {
@@ -626,46 +694,67 @@ class GCedVarOrField : public MatchFinder::MatchCallback {
 
 }  // namespace
 
-void FindBadPatterns(clang::ASTContext& ast_context,
-                     DiagnosticsReporter& diagnostics,
-                     RecordCache& record_cache,
-                     const BlinkGCPluginOptions& options) {
-  MatchFinder match_finder;
-
-  UniquePtrGarbageCollectedMatcher unique_ptr_gc(diagnostics);
-  unique_ptr_gc.Register(match_finder);
-
-  OptionalOrRawPtrToGCedMatcher optional_or_rawptr_gc(diagnostics,
-                                                      record_cache);
-  optional_or_rawptr_gc.Register(match_finder);
+class BadPatternFinder::Matchers {
+ public:
+  Matchers(clang::ASTContext& ast_context,
+           DiagnosticsReporter& diagnostics,
+           RecordCache& record_cache)
+      : unique_ptr_gc(queue, diagnostics),
+        optional_or_rawptr_gc(queue, diagnostics, record_cache),
+        collection_of_gc(queue, diagnostics, record_cache),
+        variant_gc(queue, diagnostics),
+        member_on_stack(queue, diagnostics),
+        padding_in_gced(queue, ast_context, diagnostics),
+        weak_ptr_to_gced(queue, diagnostics),
+        gced_var_or_field(queue, diagnostics),
+        optional_member(queue, diagnostics, record_cache) {}
+
+  MatchQueue queue;
+  UniquePtrGarbageCollectedMatcher unique_ptr_gc;
+  OptionalOrRawPtrToGCedMatcher optional_or_rawptr_gc;
+  CollectionOfGarbageCollectedMatcher collection_of_gc;
+  VariantGarbageCollectedMatcher variant_gc;
+  MemberOnStackMatcher member_on_stack;
+  PaddingInGCedMatcher padding_in_gced;
+  WeakPtrToGCedMatcher weak_ptr_to_gced;
+  GCedVarOrField gced_var_or_field;
+  OptionalMemberMatcher optional_member;
+};
 
-  CollectionOfGarbageCollectedMatcher collection_of_gc(diagnostics,
-                                                       record_cache);
-  if (options.enable_off_heap_collections_of_gced_check) {
-    collection_of_gc.Register(match_finder);
+BadPatternFinder::BadPatternFinder(clang::ASTContext& ast_context,
+                                   DiagnosticsReporter& diagnostics,
+                                   RecordCache& record_cache,
+                                   const BlinkGCPluginOptions& options)
+    : ast_context_(ast_context),
+      options_(options),
+      matchers_(std::make_unique<Matchers>(ast_context,
+                                           diagnostics,
+                                           record_cache)) {}
+
+BadPatternFinder::~BadPatternFinder() = default;
+
+void BadPatternFinder::Register(MatchFinder& match_finder) {
+  matchers_->unique_ptr_gc.Register(match_finder);
+  matchers_->optional_or_rawptr_gc.Register(match_finder);
+  if (options_.enable_off_heap_collections_of_gced_check) {
+    matchers_->collection_of_gc.Register(match_finder);
   }
-
-  VariantGarbageCollectedMatcher variant_gc(diagnostics);
-  variant_gc.Register(match_finder);
-
-  MemberOnStackMatcher member_on_stack(diagnostics);
-  if (options.enable_members_on_stack_check) {
-    member_on_stack.Register(match_finder);
+  matchers_->variant_gc.Register(match_finder);
+  if (options_.enable_members_on_stack_check) {
+    matchers_->member_on_stack.Register(match_finder);
   }
-
-  PaddingInGCedMatcher padding_in_gced(ast_context, diagnostics);
-  if (options.enable_extra_padding_check) {
-    padding_in_gced.Register(match_finder);
+  if (options_.enable_extra_padding_check) {
+    matchers_->padding_in_gced.Register(match_finder);
   }
+  matchers_->weak_ptr_to_gced.Register(match_finder);
+  matchers_->gced_var_or_field.Register(match_finder);
+  matchers_->optional_member.Register(match_finder);
+}
 
-  WeakPtrToGCedMatcher weak_ptr_to_gced(diagnostics);
-  weak_ptr_to_gced.Register(match_finder);
-
-  GCedVarOrField gced_var_or_field(diagnostics);
-  gced_var_or_field.Register(match_finder);
-
-  OptionalMemberMatcher optional_member(diagnostics, record_cache);
-  optional_member.Register(match_finder);
-
-  match_finder.matchAST(ast_context);
+void BadPatternFinder::Report(CheckTimes* times) {
+  for (const auto& match : matchers_->queue) {
+    CheckTimer timer(times, match.first->getID());
+    match.first->Report(MatchFinder::MatchResult(match.second, &ast_context_));
+  }
+  matchers_->queue.clear();
 }
@@ -2,17 +2,48 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#ifndef TOOLS_BLINK_GC_PLUGIN_BAD_PATTERN_FINDER_H_
+#define TOOLS_BLINK_GC_PLUGIN_BAD_PATTERN_FINDER_H_
+
+#include <memory>
+
+#include "CheckTimer.h"
+
 struct BlinkGCPluginOptions;
 class DiagnosticsReporter;
 class RecordCache;
 
 namespace clang {
 class ASTContext;
+namespace ast_matchers {
+class MatchFinder;
+}  // namespace ast_matchers
 }  // namespace clang
 
 // Detects and reports use of banned patterns, such as applying
-// std::make_unique to a garbage-collected type.
-void FindBadPatterns(clang::ASTContext& ast_context,
-                     DiagnosticsReporter&,
-                     RecordCache& record_cache,
-                     const BlinkGCPluginOptions&);
+// std::make_unique to a garbage-collected type. The matchers are registered on
+// the MatchFinder which traverses the translation unit for all of the plugin,
+// and the patterns they find are reported by Report(), after the records the
+// traversal collects have been checked.
+class BadPatternFinder {
+ public:
+  BadPatternFinder(clang::ASTContext& ast_context,
+                   DiagnosticsReporter&,
+                   RecordCache& record_cache,
+                   const BlinkGCPluginOptions&);
+  ~BadPatternFinder();
+
+  void Register(clang::ast_matchers::MatchFinder& match_finder);
+  // Reports the patterns found, adding the time taken to report the matches
+  // of each matcher to |times| if it is not null.
+  void Report(CheckTimes* times);
+
+ private:
+  class Matchers;
+
+  clang::ASTContext& ast_context_;
+  const BlinkGCPluginOptions& options_;
+  std::unique_ptr<Matchers> matchers_;
+};
+
+#endif  // TOOLS_BLINK_GC_PLUGIN_BAD_PATTERN_FINDER_H_
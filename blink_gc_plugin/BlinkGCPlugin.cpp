@@ -17,6 +17,13 @@
 
 using namespace clang;
 
+namespace {
+
+const char kResultCacheDirArgPrefix[] = "result-cache-dir=";
+const char kHeaderOwnersArgPrefix[] = "header-owners=";
+
+}  // namespace
+
 class BlinkGCPluginAction : public PluginASTAction {
  public:
   BlinkGCPluginAction() {}
@@ -34,9 +41,12 @@ class BlinkGCPluginAction : public PluginASTAction {
 
   bool ParseArgs(const CompilerInstance&,
                  const std::vector<std::string>& args) override {
-    for (const auto& arg : args) {
+    for (llvm::StringRef arg : args) {
       if (arg == "dump-graph") {
         options_.dump_graph = true;
+      } else if (arg == "dump-binary-graph") {
+        options_.dump_graph = true;
+        options_.dump_binary_graph = true;
       } else if (arg == "enable-persistent-in-unique-ptr-check") {
         options_.enable_persistent_in_unique_ptr_check = true;
       } else if (arg == "enable-members-on-stack-check") {
@@ -47,11 +57,34 @@ class BlinkGCPluginAction : public PluginASTAction {
         options_.enable_off_heap_collections_of_gced_check = false;
       } else if (arg == "enable-ptrs-to-traceable-check") {
         options_.enable_ptrs_to_traceable_check = true;
+      } else if (arg.starts_with(kResultCacheDirArgPrefix)) {
+        options_.result_cache_dir =
+            arg.substr(strlen(kResultCacheDirArgPrefix)).str();
+      } else if (arg == "print-result-cache-stats") {
+        options_.print_result_cache_stats = true;
+      } else if (arg == "check-headers-in-owner-tu") {
+        options_.check_headers_in_owner_tu = true;
+      } else if (arg.starts_with(kHeaderOwnersArgPrefix)) {
+        options_.check_headers_in_owner_tu = true;
+        options_.header_owners_file =
+            arg.substr(strlen(kHeaderOwnersArgPrefix)).str();
+      } else if (arg == "enable-match-profiling") {
+        options_.enable_match_profiling = true;
       } else {
         llvm::errs() << "Unknown blink-gc-plugin argument: " << arg << "\n";
         return false;
       }
     }
+
+    // Without a header owners file, a header whose source file exists next to
+    // it but is not built, e.g. on another platform, is never checked.
+    if (options_.check_headers_in_owner_tu &&
+        options_.header_owners_file.empty()) {
+      llvm::errs() << "[blink-gc] Warning: check-headers-in-owner-tu takes the "
+                      "owner of each header from the source files next to it, "
+                      "which may not be built. Pass header-owners=<path> with "
+                      "a file generated from the build instead.\n";
+    }
     return true;
   }
 
@@ -5,7 +5,7 @@
 #include "BlinkGCPluginConsumer.h"
 
 #include <algorithm>
-#include <set>
+#include <vector>
 
 #include "BadPatternFinder.h"
 #include "CheckDispatchVisitor.h"
@@ -13,11 +13,14 @@
 #include "CheckFinalizerVisitor.h"
 #include "CheckForbiddenFieldsVisitor.h"
 #include "CheckGCRootsVisitor.h"
+#include "CheckTimer.h"
 #include "CheckTraceVisitor.h"
 #include "CollectVisitor.h"
-#include "JsonWriter.h"
+#include "GraphWriter.h"
+#include "HeaderOwnership.h"
 #include "RecordInfo.h"
 #include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/Sema/Sema.h"
 #include "llvm/Support/TimeProfiler.h"
 
@@ -25,22 +28,7 @@ using namespace clang;
 
 namespace {
 
-// Use a local RAV implementation to simply collect all FunctionDecls marked for
-// late template parsing. This happens with the flag -fdelayed-template-parsing,
-// which is on by default in MSVC-compatible mode.
-std::set<FunctionDecl*> GetLateParsedFunctionDecls(TranslationUnitDecl* decl) {
-  struct Visitor : public RecursiveASTVisitor<Visitor> {
-    bool VisitFunctionDecl(FunctionDecl* function_decl) {
-      if (function_decl->isLateTemplateParsed())
-        late_parsed_decls.insert(function_decl);
-      return true;
-    }
-
-    std::set<FunctionDecl*> late_parsed_decls;
-  } v;
-  v.TraverseDecl(decl);
-  return v.late_parsed_decls;
-}
+const size_t kGraphBufferSize = 1 << 20;
 
 class EmptyStmtVisitor : public RecursiveASTVisitor<EmptyStmtVisitor> {
  public:
@@ -84,8 +72,7 @@ BlinkGCPluginConsumer::BlinkGCPluginConsumer(
     : instance_(instance),
       reporter_(instance),
       options_(options),
-      cache_(instance),
-      json_(0) {
+      cache_(instance) {
   // Only check structures in blink, cppgc and pdfium.
   options_.checked_namespaces.insert("blink");
   options_.checked_namespaces.insert("cppgc");
@@ -100,6 +87,15 @@ BlinkGCPluginConsumer::BlinkGCPluginConsumer(
       "third_party/blink/renderer/platform/heap/collection_support/");
   options_.ignored_directories.push_back("v8/src/heap/cppgc/");
   options_.ignored_directories.push_back("v8/src/heap/cppgc-js/");
+
+  // The graph dump needs every class, so its runs check them all.
+  if (!options_.result_cache_dir.empty() && !options_.dump_graph) {
+    result_cache_ =
+        std::make_unique<RecordResultCache>(instance, &cache_, options_);
+  }
+
+  if (options_.enable_match_profiling)
+    check_times_ = std::make_unique<CheckTimes>();
 }
 
 void BlinkGCPluginConsumer::HandleTranslationUnit(ASTContext& context) {
@@ -109,68 +105,118 @@ void BlinkGCPluginConsumer::HandleTranslationUnit(ASTContext& context) {
   if (reporter_.hasErrorOccurred())
     return;
 
-  ParseFunctionTemplates(context.getTranslationUnitDecl());
+  ParseFunctionTemplates();
+
+  std::unique_ptr<HeaderOwnership> ownership;
+  if (options_.check_headers_in_owner_tu) {
+    ownership = std::make_unique<HeaderOwnership>(instance_.getSourceManager(),
+                                                  options_);
+  }
 
-  CollectVisitor visitor;
-  visitor.TraverseDecl(context.getTranslationUnitDecl());
+  // A single traversal of the translation unit both collects the records and
+  // trace methods to check and finds the bad patterns, which are reported
+  // after the checks of the records.
+  ast_matchers::MatchFinder::MatchFinderOptions finder_options;
+  if (check_times_)
+    finder_options.CheckProfiling.emplace(*check_times_);
+  ast_matchers::MatchFinder match_finder(std::move(finder_options));
+  CollectVisitor visitor(ownership.get());
+  visitor.Register(match_finder);
+  BadPatternFinder bad_patterns(context, reporter_, cache_, options_);
+  bad_patterns.Register(match_finder);
+  {
+    llvm::TimeTraceScope TimeScope(
+        "match_finder.matchAST in BlinkGCPluginConsumer");
+    match_finder.matchAST(context);
+  }
 
   if (options_.dump_graph) {
-    std::error_code err;
     SmallString<128> OutputFile(instance_.getFrontendOpts().OutputFile);
-    llvm::sys::path::replace_extension(OutputFile, "graph.json");
-    json_ = JsonWriter::from(instance_.createOutputFile(
+    llvm::sys::path::replace_extension(
+        OutputFile, options_.dump_binary_graph ? "graph.bin" : "graph.json");
+    std::unique_ptr<llvm::raw_pwrite_stream> os = instance_.createOutputFile(
         OutputFile,                              // OutputPath
         true,                                    // Binary
         true,                                    // RemoveFileOnSignal
         false,                                   // UseTemporary
-        false));                                 // CreateMissingDirectories
-    if (!err && json_) {
-      json_->OpenList();
+        false);                                  // CreateMissingDirectories
+    if (os) {
+      // The graph is written in many small pieces.
+      os->SetBufferSize(kGraphBufferSize);
+      const SourceManager& source_manager = instance_.getSourceManager();
+      graph_ = options_.dump_binary_graph
+                   ? GraphWriter::CreateBinary(source_manager, std::move(os))
+                   : GraphWriter::CreateJson(source_manager, std::move(os));
     } else {
-      json_ = 0;
       llvm::errs()
           << "[blink-gc] "
           << "Failed to create an output file for the object graph.\n";
     }
   }
 
-  for (const auto& record : visitor.record_decls())
-    CheckRecord(cache_.Lookup(record));
+  {
+    llvm::TimeTraceScope TimeScope("CheckRecord in BlinkGCPluginConsumer");
+    for (const auto& record : visitor.record_decls())
+      CheckRecord(cache_.Lookup(record));
+  }
 
-  for (const auto& method : visitor.trace_decls())
-    CheckTracingMethod(method);
+  {
+    llvm::TimeTraceScope TimeScope(
+        "CheckTracingMethod in BlinkGCPluginConsumer");
+    for (const auto& method : visitor.trace_decls())
+      CheckTracingMethod(method);
+  }
+
+  graph_.reset();
 
-  if (json_) {
-    json_->CloseList();
-    delete json_;
-    json_ = 0;
+  {
+    llvm::TimeTraceScope TimeScope("BadPatternFinder::Report");
+    bad_patterns.Report(check_times_.get());
   }
 
-  FindBadPatterns(context, reporter_, cache_, options_);
+  if (check_times_) {
+    llvm::TimerGroup timer_group("BlinkGCPlugin",
+                                 "Blink GC plugin check profiling",
+                                 *check_times_);
+    timer_group.print(llvm::errs());
+    check_times_->clear();
+  }
+
+  if (result_cache_ && options_.print_result_cache_stats)
+    result_cache_->PrintStats(llvm::errs());
 }
 
-void BlinkGCPluginConsumer::ParseFunctionTemplates(TranslationUnitDecl* decl) {
+// With the flag -fdelayed-template-parsing, which is on by default in
+// MSVC-compatible mode, the bodies of function templates which are never
+// instantiated are not parsed. Those of trace methods are parsed before the
+// translation unit is traversed, so that the traversal and the parent map of
+// the matchers see them.
+void BlinkGCPluginConsumer::ParseFunctionTemplates() {
   if (!instance_.getLangOpts().DelayedTemplateParsing)
     return;  // Nothing to do.
 
-  std::set<FunctionDecl*> late_parsed_decls = GetLateParsedFunctionDecls(decl);
-  clang::Sema& sema = instance_.getSema();
-
-  for (const FunctionDecl* fd : late_parsed_decls) {
-    assert(fd->isLateTemplateParsed());
+  Sema& sema = instance_.getSema();
+  SourceManager& source_manager = instance_.getSourceManager();
 
-    if (!Config::IsTraceMethod(fd))
+  // Parsing a template may add to the map, so the templates to parse are
+  // gathered first.
+  std::vector<LateParsedTemplate*> late_parsed_templates;
+  for (const auto& entry : sema.LateParsedTemplateMap) {
+    const FunctionDecl* fd = entry.first;
+    if (!fd->isLateTemplateParsed() || !Config::IsTraceMethod(fd))
       continue;
 
-    if (instance_.getSourceManager().isInSystemHeader(
-            instance_.getSourceManager().getSpellingLoc(fd->getLocation())))
+    if (source_manager.isInSystemHeader(
+            source_manager.getSpellingLoc(fd->getLocation())))
       continue;
 
-    // Force parsing and AST building of the yet-uninstantiated function
-    // template trace method bodies.
-    clang::LateParsedTemplate* lpt = sema.LateParsedTemplateMap[fd].get();
-    sema.LateTemplateParser(sema.OpaqueParser, *lpt);
+    late_parsed_templates.push_back(entry.second.get());
   }
+
+  // Force parsing and AST building of the yet-uninstantiated function
+  // template trace method bodies.
+  for (LateParsedTemplate* lpt : late_parsed_templates)
+    sema.LateTemplateParser(sema.OpaqueParser, *lpt);
 }
 
 void BlinkGCPluginConsumer::CheckRecord(RecordInfo* info) {
@@ -202,6 +248,10 @@ void BlinkGCPluginConsumer::CheckClass(RecordInfo* info) {
   if (!info)
     return;
 
+  if (result_cache_ && result_cache_->IsVerified(info->record()))
+    return;
+  unsigned num_reported = reporter_.num_reported();
+
   if (CXXMethodDecl* trace = info->GetTraceMethod()) {
     if (info->IsStackAllocated())
       reporter_.TraceMethodForStackAllocatedClass(info, trace);
@@ -220,6 +270,7 @@ void BlinkGCPluginConsumer::CheckClass(RecordInfo* info) {
   }
 
   {
+    CheckTimer timer(check_times_.get(), "CheckFieldsVisitor");
     CheckFieldsVisitor visitor(options_);
     if (visitor.ContainsInvalidFields(info))
       reporter_.ClassContainsInvalidFields(info, visitor.invalid_fields());
@@ -269,21 +320,29 @@ void BlinkGCPluginConsumer::CheckClass(RecordInfo* info) {
     }
 
     {
+      CheckTimer timer(check_times_.get(), "CheckGCRootsVisitor");
       CheckGCRootsVisitor visitor(options_);
       if (visitor.ContainsGCRoots(info))
         reporter_.ClassContainsGCRoots(info, visitor.gc_roots());
       reporter_.ClassContainsGCRootRefs(info, visitor.gc_root_refs());
     }
 
-    CheckForbiddenFieldsVisitor visitor;
-    if (visitor.ContainsForbiddenFields(info)) {
-      reporter_.ClassContainsForbiddenFields(info, visitor.forbidden_fields());
+    {
+      CheckTimer timer(check_times_.get(), "CheckForbiddenFieldsVisitor");
+      CheckForbiddenFieldsVisitor visitor;
+      if (visitor.ContainsForbiddenFields(info)) {
+        reporter_.ClassContainsForbiddenFields(info,
+                                               visitor.forbidden_fields());
+      }
     }
 
     if (info->NeedsFinalization())
       CheckFinalization(info);
   }
 
+  if (result_cache_ && reporter_.num_reported() == num_reported)
+    result_cache_->MarkVerified(info->record());
+
   DumpClass(info);
 }
 
@@ -445,6 +504,7 @@ void BlinkGCPluginConsumer::CheckDispatch(RecordInfo* info) {
   const FunctionDecl* defn;
 
   if (trace_dispatch && trace_dispatch->isDefined(defn)) {
+    CheckTimer timer(check_times_.get(), "CheckDispatchVisitor");
     CheckDispatchVisitor visitor(info);
     visitor.TraverseStmt(defn->getBody());
     if (!visitor.dispatched_to_receiver())
@@ -452,6 +512,7 @@ void BlinkGCPluginConsumer::CheckDispatch(RecordInfo* info) {
   }
 
   if (finalize_dispatch && finalize_dispatch->isDefined(defn)) {
+    CheckTimer timer(check_times_.get(), "CheckDispatchVisitor");
     CheckDispatchVisitor visitor(info);
     visitor.TraverseStmt(defn->getBody());
     if (!visitor.dispatched_to_receiver())
@@ -466,7 +527,10 @@ void BlinkGCPluginConsumer::CheckFinalization(RecordInfo* info) {
     return;
 
   CheckFinalizerVisitor visitor(&cache_);
-  visitor.TraverseCXXMethodDecl(dtor);
+  {
+    CheckTimer timer(check_times_.get(), "CheckFinalizerVisitor");
+    visitor.TraverseCXXMethodDecl(dtor);
+  }
   if (!visitor.finalized_fields().empty()) {
     reporter_.FinalizerAccessesFinalizedFields(dtor,
                                                visitor.finalized_fields());
@@ -518,7 +582,10 @@ void BlinkGCPluginConsumer::CheckTraceMethod(
   }
 
   CheckTraceVisitor visitor(trace, parent, &cache_);
-  visitor.TraverseCXXMethodDecl(trace);
+  {
+    CheckTimer timer(check_times_.get(), "CheckTraceVisitor");
+    visitor.TraverseCXXMethodDecl(trace);
+  }
 
   for (auto& base : parent->GetBases())
     if (!base.second.IsProperlyTraced())
@@ -535,41 +602,36 @@ void BlinkGCPluginConsumer::CheckTraceMethod(
 }
 
 void BlinkGCPluginConsumer::DumpClass(RecordInfo* info) {
-  if (!json_)
+  if (!graph_)
     return;
 
-  json_->OpenObject();
-  json_->Write("name", info->record()->getQualifiedNameAsString());
-  json_->Write("loc", GetLocString(info->record()->getBeginLoc()));
-  json_->CloseObject();
+  graph_->WriteNode(info->record()->getQualifiedNameAsString(),
+                    info->record()->getBeginLoc());
 
   class DumpEdgeVisitor : public RecursiveEdgeVisitor {
    public:
-    DumpEdgeVisitor(JsonWriter* json) : json_(json) {}
+    DumpEdgeVisitor(GraphWriter* graph) : graph_(graph) {}
     void DumpEdge(RecordInfo* src,
                   RecordInfo* dst,
                   const std::string& lbl,
                   const Edge::LivenessKind& kind,
-                  const std::string& loc) {
-      json_->OpenObject();
-      json_->Write("src", src->record()->getQualifiedNameAsString());
-      json_->Write("dst", dst->record()->getQualifiedNameAsString());
-      json_->Write("lbl", lbl);
-      json_->Write("kind", kind);
-      json_->Write("loc", loc);
-      json_->Write("ptr",
-                   !Parent() ? "val" :
-                   Parent()->IsRawPtr() ?
-                       (static_cast<RawPtr*>(Parent())->HasReferenceType() ?
-                        "reference" : "raw") :
-                   Parent()->IsRefPtr() ? "ref" :
-                   Parent()->IsUniquePtr() ? "unique" :
-                   (Parent()->IsMember() || Parent()->IsWeakMember()) ? "mem" :
-                   "val");
-      json_->CloseObject();
+                  SourceLocation loc) {
+      graph_->WriteEdge(
+          src->record()->getQualifiedNameAsString(),
+          dst->record()->getQualifiedNameAsString(), lbl, kind,
+          !Parent() ? GraphWriter::kValue :
+          Parent()->IsRawPtr() ?
+              (static_cast<RawPtr*>(Parent())->HasReferenceType() ?
+               GraphWriter::kReference : GraphWriter::kRawPointer) :
+          Parent()->IsRefPtr() ? GraphWriter::kRefPtr :
+          Parent()->IsUniquePtr() ? GraphWriter::kUniquePtr :
+          (Parent()->IsMember() || Parent()->IsWeakMember()) ?
+              GraphWriter::kMember :
+          GraphWriter::kValue,
+          loc);
     }
 
-    void DumpField(RecordInfo* src, FieldPoint* point, const std::string& loc) {
+    void DumpField(RecordInfo* src, FieldPoint* point, SourceLocation loc) {
       src_ = src;
       point_ = point;
       loc_ = loc;
@@ -593,34 +655,21 @@ void BlinkGCPluginConsumer::DumpClass(RecordInfo* info) {
     }
 
    private:
-    JsonWriter* json_;
+    GraphWriter* graph_;
     RecordInfo* src_;
     FieldPoint* point_;
-    std::string loc_;
+    SourceLocation loc_;
   };
 
-  DumpEdgeVisitor visitor(json_);
+  DumpEdgeVisitor visitor(graph_.get());
 
   for (auto& base : info->GetBases())
     visitor.DumpEdge(info, base.second.info(), "<super>", Edge::kStrong,
-                     GetLocString(base.second.spec().getBeginLoc()));
+                     base.second.spec().getBeginLoc());
 
   for (auto& field : info->GetFields())
     visitor.DumpField(info, &field.second,
-                      GetLocString(field.second.field()->getBeginLoc()));
-}
-
-std::string BlinkGCPluginConsumer::GetLocString(SourceLocation loc) {
-  const SourceManager& source_manager = instance_.getSourceManager();
-  PresumedLoc ploc = source_manager.getPresumedLoc(loc);
-  if (ploc.isInvalid())
-    return "";
-  std::string loc_str;
-  llvm::raw_string_ostream os(loc_str);
-  os << ploc.getFilename()
-     << ":" << ploc.getLine()
-     << ":" << ploc.getColumn();
-  return os.str();
+                      field.second.field()->getBeginLoc());
 }
 
 bool BlinkGCPluginConsumer::IsIgnored(RecordInfo* record) {
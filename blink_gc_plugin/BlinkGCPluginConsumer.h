@@ -5,17 +5,20 @@
 #ifndef TOOLS_BLINK_GC_PLUGIN_BLINK_GC_PLUGIN_CONSUMER_H_
 #define TOOLS_BLINK_GC_PLUGIN_BLINK_GC_PLUGIN_CONSUMER_H_
 
+#include <memory>
 #include <string>
 
 #include "BlinkGCPluginOptions.h"
+#include "CheckTimer.h"
 #include "Config.h"
 #include "DiagnosticsReporter.h"
+#include "GraphWriter.h"
+#include "RecordResultCache.h"
 #include "clang/AST/AST.h"
 #include "clang/AST/ASTConsumer.h"
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Frontend/CompilerInstance.h"
 
-class JsonWriter;
 class RecordInfo;
 
 // Main class containing checks for various invariants of the Blink
@@ -28,7 +31,7 @@ class BlinkGCPluginConsumer : public clang::ASTConsumer {
   void HandleTranslationUnit(clang::ASTContext& context) override;
 
  private:
-  void ParseFunctionTemplates(clang::TranslationUnitDecl* decl);
+  void ParseFunctionTemplates();
 
   // Main entry for checking a record declaration.
   void CheckRecord(RecordInfo* info);
@@ -67,8 +70,6 @@ class BlinkGCPluginConsumer : public clang::ASTConsumer {
   // Adds either a warning or error, based on the current handling of -Werror.
   clang::DiagnosticsEngine::Level getErrorLevel();
 
-  std::string GetLocString(clang::SourceLocation loc);
-
   bool IsIgnored(RecordInfo* info);
 
   bool IsIgnoredClass(RecordInfo* info);
@@ -83,7 +84,13 @@ class BlinkGCPluginConsumer : public clang::ASTConsumer {
   DiagnosticsReporter reporter_;
   BlinkGCPluginOptions options_;
   RecordCache cache_;
-  JsonWriter* json_;
+  // Null unless the results of checking records are cached across
+  // translation units.
+  std::unique_ptr<RecordResultCache> result_cache_;
+  // Null unless the time of each check is profiled.
+  std::unique_ptr<CheckTimes> check_times_;
+  // Null unless the graph is dumped.
+  std::unique_ptr<GraphWriter> graph_;
 };
 
 #endif  // TOOLS_BLINK_GC_PLUGIN_BLINK_GC_PLUGIN_CONSUMER_H_
@@ -11,6 +11,9 @@
 
 struct BlinkGCPluginOptions {
   bool dump_graph = false;
+  // Dumps the graph in the binary format of GraphWriter.h rather than as
+  // JSON, which implies the above.
+  bool dump_binary_graph = false;
 
   // Persistent<T> fields are not allowed in garbage collected classes to avoid
   // memory leaks. Enabling this flag allows the plugin to check also for
@@ -48,6 +51,25 @@ struct BlinkGCPluginOptions {
   // Enables checks for raw pointers, refs and unique_ptr of traceable types.
   bool enable_ptrs_to_traceable_check = false;
 
+  // If set, records of headers which were checked without diagnostics are
+  // remembered in this directory, so that other translation units including
+  // the same headers can skip checking them again. See RecordResultCache.h.
+  std::string result_cache_dir;
+  // Prints how many records hit and missed the above, and the time spent
+  // looking them up.
+  bool print_result_cache_stats = false;
+
+  // If set, the records and trace methods of each header are only checked by
+  // the translation unit which owns the header, rather than by every one
+  // including it. See HeaderOwnership.h.
+  bool check_headers_in_owner_tu = false;
+  // A file mapping headers to their owners, which implies the above.
+  std::string header_owners_file;
+
+  // Prints the time taken by each matcher and check visitor, and adds them to
+  // the -ftime-trace output.
+  bool enable_match_profiling = false;
+
   std::set<std::string> ignored_classes;
   std::set<std::string> checked_namespaces;
   std::vector<std::string> checked_directories;
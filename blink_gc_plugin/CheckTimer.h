@@ -0,0 +1,54 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLS_BLINK_GC_PLUGIN_CHECK_TIMER_H_
+#define TOOLS_BLINK_GC_PLUGIN_CHECK_TIMER_H_
+
+#include <optional>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/Timer.h"
+
+// The time spent in each check, by the name of the check. The MatchFinder
+// adds the time of each matcher to the same records, by its getID(), so that
+// they can be printed as a single TimerGroup.
+using CheckTimes = llvm::StringMap<llvm::TimeRecord>;
+
+// Times a scope running the check |name|, in the -ftime-trace output if the
+// time profiler is enabled, and in |times| if it is not null. It is null
+// unless the plugin was asked for profiling, since the checks run far too
+// often for their timers to be free.
+class CheckTimer {
+ public:
+  CheckTimer(CheckTimes* times, llvm::StringRef name)
+      : times_(times), name_(name) {
+    if (llvm::getTimeTraceProfilerInstance())
+      trace_scope_.emplace(name);
+    if (!times_)
+      return;
+    start_ = llvm::TimeRecord::getCurrentTime(/*Start=*/true);
+  }
+
+  ~CheckTimer() {
+    if (!times_)
+      return;
+    llvm::TimeRecord elapsed =
+        llvm::TimeRecord::getCurrentTime(/*Start=*/false);
+    elapsed -= start_;
+    (*times_)[name_] += elapsed;
+  }
+
+  CheckTimer(const CheckTimer&) = delete;
+  CheckTimer& operator=(const CheckTimer&) = delete;
+
+ private:
+  CheckTimes* times_;
+  llvm::StringRef name_;
+  std::optional<llvm::TimeTraceScope> trace_scope_;
+  llvm::TimeRecord start_;
+};
+
+#endif  // TOOLS_BLINK_GC_PLUGIN_CHECK_TIMER_H_
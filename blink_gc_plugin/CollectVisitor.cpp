@@ -5,12 +5,45 @@
 #include "CollectVisitor.h"
 
 #include "Config.h"
+#include "HeaderOwnership.h"
+#include "clang/ASTMatchers/ASTMatchers.h"
+#include "llvm/Support/TimeProfiler.h"
 
 using namespace clang;
+using namespace clang::ast_matchers;
 
-CollectVisitor::CollectVisitor() {
+namespace {
+
+// Returns false if |decl| is implicit or belongs to a template instantiation,
+// which a RecursiveASTVisitor with the default options would not visit. The
+// node of an explicit instantiation is visited, but its members are not.
+bool IsWrittenDecl(const Decl* decl) {
+  for (const Decl* current = decl; current;
+       current = dyn_cast_or_null<Decl>(current->getLexicalDeclContext())) {
+    if (current->isImplicit())
+      return false;
+    if (const auto* specialization =
+            dyn_cast<ClassTemplateSpecializationDecl>(current)) {
+      TemplateSpecializationKind kind =
+          specialization->getSpecializationKind();
+      if (kind == TSK_ImplicitInstantiation)
+        return false;
+      if (kind != TSK_ExplicitSpecialization && current != decl)
+        return false;
+    }
+    if (const auto* function = dyn_cast<FunctionDecl>(current)) {
+      if (function->isTemplateInstantiation())
+        return false;
+    }
+  }
+  return true;
 }
 
+}  // namespace
+
+CollectVisitor::CollectVisitor(HeaderOwnership* ownership)
+    : ownership_(ownership) {}
+
 CollectVisitor::RecordVector& CollectVisitor::record_decls() {
   return record_decls_;
 }
@@ -19,17 +52,42 @@ CollectVisitor::MethodVector& CollectVisitor::trace_decls() {
   return trace_decls_;
 }
 
-bool CollectVisitor::VisitCXXRecordDecl(CXXRecordDecl* record) {
-  if (record->hasDefinition() && record->isCompleteDefinition())
+void CollectVisitor::Register(MatchFinder& match_finder) {
+  match_finder.addMatcher(cxxRecordDecl().bind("record"), this);
+  match_finder.addMatcher(functionDecl().bind("function"), this);
+}
+
+void CollectVisitor::run(const MatchFinder::MatchResult& result) {
+  llvm::TimeTraceScope TimeScope(getID());
+  Decl* decl = const_cast<Decl*>(result.Nodes.getNodeAs<Decl>("record"));
+  if (!decl)
+    decl = const_cast<Decl*>(result.Nodes.getNodeAs<Decl>("function"));
+  if (!decl || !IsWrittenDecl(decl) || !visited_.insert(decl).second)
+    return;
+
+  if (auto* record = dyn_cast<CXXRecordDecl>(decl)) {
+    // Lambdas are visited through their closure types only as implicit code.
+    if (!record->isLambda())
+      VisitCXXRecordDecl(record);
+    return;
+  }
+
+  if (auto* method = dyn_cast<CXXMethodDecl>(decl))
+    VisitCXXMethodDecl(method);
+}
+
+void CollectVisitor::VisitCXXRecordDecl(CXXRecordDecl* record) {
+  if (record->hasDefinition() && record->isCompleteDefinition() &&
+      (!ownership_ || ownership_->IsOwned(record))) {
     record_decls_.push_back(record);
-  return true;
+  }
 }
 
-bool CollectVisitor::VisitCXXMethodDecl(CXXMethodDecl* method) {
+void CollectVisitor::VisitCXXMethodDecl(CXXMethodDecl* method) {
   if (method->isThisDeclarationADefinition()) {
-    if (Config::IsTraceMethod(method)) {
+    if (Config::IsTraceMethod(method) &&
+        (!ownership_ || ownership_->IsOwned(method))) {
       trace_decls_.push_back(method);
     }
   }
-  return true;
 }
@@ -8,26 +8,44 @@
 #include <vector>
 
 #include "clang/AST/AST.h"
-#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "llvm/ADT/DenseSet.h"
 
-// This visitor collects the entry points for the checker.
-class CollectVisitor : public clang::RecursiveASTVisitor<CollectVisitor> {
+class HeaderOwnership;
+
+// This visitor collects the entry points for the checker. It is driven by the
+// MatchFinder which traverses the translation unit once for all of the plugin,
+// and which also visits implicit code and template instantiations. Those are
+// not collected, since they are not written in the source.
+class CollectVisitor
+    : public clang::ast_matchers::MatchFinder::MatchCallback {
  public:
   typedef std::vector<clang::CXXRecordDecl*> RecordVector;
   typedef std::vector<clang::CXXMethodDecl*> MethodVector;
 
-  CollectVisitor();
+  // If |ownership| is not null, only the declarations it says this
+  // translation unit owns are collected.
+  explicit CollectVisitor(HeaderOwnership* ownership);
 
   RecordVector& record_decls();
   MethodVector& trace_decls();
 
-  // Collect record declarations, including nested declarations.
-  bool VisitCXXRecordDecl(clang::CXXRecordDecl* record);
+  void Register(clang::ast_matchers::MatchFinder& match_finder);
+
+  llvm::StringRef getID() const override { return "CollectVisitor"; }
 
-  // Collect tracing method definitions, but don't traverse method bodies.
-  bool VisitCXXMethodDecl(clang::CXXMethodDecl* method);
+  void run(
+      const clang::ast_matchers::MatchFinder::MatchResult& result) override;
 
  private:
+  // Collect record declarations, including nested declarations.
+  void VisitCXXRecordDecl(clang::CXXRecordDecl* record);
+
+  // Collect tracing method definitions.
+  void VisitCXXMethodDecl(clang::CXXMethodDecl* method);
+
+  HeaderOwnership* ownership_;
+  llvm::DenseSet<clang::Decl*> visited_;
   RecordVector record_decls_;
   MethodVector trace_decls_;
 };
@@ -271,6 +271,7 @@ DiagnosticBuilder DiagnosticsReporter::ReportDiagnostic(
     unsigned diag_id) {
   SourceManager& manager = instance_.getSourceManager();
   FullSourceLoc full_loc(location, manager);
+  ++num_reported_;
   return diagnostic_.Report(full_loc, diag_id);
 }
 
@@ -26,6 +26,9 @@ class DiagnosticsReporter {
   bool hasErrorOccurred() const;
   clang::DiagnosticsEngine::Level getErrorLevel() const;
 
+  // The number of diagnostics, including notes, reported so far.
+  unsigned num_reported() const { return num_reported_; }
+
   void ClassMustLeftMostlyDeriveGC(RecordInfo* info);
   void ClassRequiresTraceMethod(RecordInfo* info);
   void BaseRequiresTracing(RecordInfo* derived,
@@ -83,7 +86,7 @@ class DiagnosticsReporter {
   void NoteField(clang::FieldDecl* field, unsigned note);
   void NoteOverriddenNonVirtualTrace(clang::CXXMethodDecl* overridden);
 
-  // Used by FindBadPatterns.
+  // Used by BadPatternFinder.
   void UniquePtrUsedWithGC(const clang::Expr* expr,
                            const clang::FunctionDecl* bad_function,
                            const clang::CXXRecordDecl* gc_type);
@@ -141,6 +144,7 @@ class DiagnosticsReporter {
 
   clang::CompilerInstance& instance_;
   clang::DiagnosticsEngine& diagnostic_;
+  unsigned num_reported_ = 0;
 
   unsigned diag_class_must_left_mostly_derive_gc_;
   unsigned diag_class_requires_trace_method_;
@@ -0,0 +1,188 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "GraphWriter.h"
+
+#include "JsonWriter.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/LEB128.h"
+
+using namespace clang;
+
+namespace {
+
+const char kBinaryGraphMagic[] = "BGCGRAPH";
+const unsigned kBinaryGraphVersion = 1;
+
+enum RecordKind : unsigned {
+  kString = 1,
+  kNode = 2,
+  kEdge = 3,
+};
+
+const char* GetPointerKindString(GraphWriter::PointerKind ptr) {
+  switch (ptr) {
+    case GraphWriter::kValue:
+      return "val";
+    case GraphWriter::kRawPointer:
+      return "raw";
+    case GraphWriter::kReference:
+      return "reference";
+    case GraphWriter::kRefPtr:
+      return "ref";
+    case GraphWriter::kUniquePtr:
+      return "unique";
+    case GraphWriter::kMember:
+      return "mem";
+  }
+  return "val";
+}
+
+class JsonGraphWriter : public GraphWriter {
+ public:
+  JsonGraphWriter(const SourceManager& source_manager,
+                  std::unique_ptr<llvm::raw_ostream> os)
+      : source_manager_(source_manager),
+        json_(JsonWriter::from(std::move(os))) {
+    json_->OpenList();
+  }
+
+  ~JsonGraphWriter() override { json_->CloseList(); }
+
+  void WriteNode(const std::string& name, SourceLocation loc) override {
+    json_->OpenObject();
+    json_->Write("name", name);
+    json_->Write("loc", GetLocString(loc));
+    json_->CloseObject();
+  }
+
+  void WriteEdge(const std::string& src,
+                 const std::string& dst,
+                 const std::string& label,
+                 Edge::LivenessKind kind,
+                 PointerKind ptr,
+                 SourceLocation loc) override {
+    json_->OpenObject();
+    json_->Write("src", src);
+    json_->Write("dst", dst);
+    json_->Write("lbl", label);
+    json_->Write("kind", kind);
+    json_->Write("loc", GetLocString(loc));
+    json_->Write("ptr", GetPointerKindString(ptr));
+    json_->CloseObject();
+  }
+
+ private:
+  std::string GetLocString(SourceLocation loc) {
+    PresumedLoc ploc = source_manager_.getPresumedLoc(loc);
+    if (ploc.isInvalid())
+      return "";
+    std::string loc_str;
+    llvm::raw_string_ostream os(loc_str);
+    os << ploc.getFilename()
+       << ":" << ploc.getLine()
+       << ":" << ploc.getColumn();
+    return os.str();
+  }
+
+  const SourceManager& source_manager_;
+  std::unique_ptr<JsonWriter> json_;
+};
+
+class BinaryGraphWriter : public GraphWriter {
+ public:
+  BinaryGraphWriter(const SourceManager& source_manager,
+                    std::unique_ptr<llvm::raw_ostream> os)
+      : source_manager_(source_manager), os_(std::move(os)) {
+    *os_ << kBinaryGraphMagic;
+    WriteVarint(kBinaryGraphVersion);
+  }
+
+  void WriteNode(const std::string& name, SourceLocation loc) override {
+    // The strings are interned first, since interning a string may write it.
+    unsigned name_index = Intern(name);
+    Location location = GetLocation(loc);
+    WriteVarint(kNode);
+    WriteVarint(name_index);
+    WriteLocation(location);
+  }
+
+  void WriteEdge(const std::string& src,
+                 const std::string& dst,
+                 const std::string& label,
+                 Edge::LivenessKind kind,
+                 PointerKind ptr,
+                 SourceLocation loc) override {
+    unsigned src_index = Intern(src);
+    unsigned dst_index = Intern(dst);
+    unsigned label_index = Intern(label);
+    Location location = GetLocation(loc);
+    WriteVarint(kEdge);
+    WriteVarint(src_index);
+    WriteVarint(dst_index);
+    WriteVarint(label_index);
+    WriteVarint(kind);
+    WriteVarint(ptr);
+    WriteLocation(location);
+  }
+
+ private:
+  struct Location {
+    // 0 if the location is invalid, or else 1 + the index of the file name.
+    unsigned file = 0;
+    unsigned line = 0;
+    unsigned column = 0;
+  };
+
+  unsigned Intern(llvm::StringRef str) {
+    auto result = strings_.try_emplace(str, strings_.size());
+    if (result.second) {
+      WriteVarint(kString);
+      WriteVarint(str.size());
+      *os_ << str;
+    }
+    return result.first->second;
+  }
+
+  Location GetLocation(SourceLocation loc) {
+    Location location;
+    PresumedLoc ploc = source_manager_.getPresumedLoc(loc);
+    if (ploc.isInvalid())
+      return location;
+    location.file = 1 + Intern(ploc.getFilename());
+    location.line = ploc.getLine();
+    location.column = ploc.getColumn();
+    return location;
+  }
+
+  void WriteLocation(const Location& location) {
+    WriteVarint(location.file);
+    if (!location.file)
+      return;
+    WriteVarint(location.line);
+    WriteVarint(location.column);
+  }
+
+  void WriteVarint(uint64_t value) { llvm::encodeULEB128(value, *os_); }
+
+  const SourceManager& source_manager_;
+  std::unique_ptr<llvm::raw_ostream> os_;
+  llvm::StringMap<unsigned> strings_;
+};
+
+}  // namespace
+
+// static
+std::unique_ptr<GraphWriter> GraphWriter::CreateJson(
+    const SourceManager& source_manager,
+    std::unique_ptr<llvm::raw_ostream> os) {
+  return std::make_unique<JsonGraphWriter>(source_manager, std::move(os));
+}
+
+// static
+std::unique_ptr<GraphWriter> GraphWriter::CreateBinary(
+    const SourceManager& source_manager,
+    std::unique_ptr<llvm::raw_ostream> os) {
+  return std::make_unique<BinaryGraphWriter>(source_manager, std::move(os));
+}
@@ -0,0 +1,67 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file writes the points-to graph which the dump-graph option dumps for
+// process-graph.py, either as JSON or in a compact binary format.
+
+#ifndef TOOLS_BLINK_GC_PLUGIN_GRAPH_WRITER_H_
+#define TOOLS_BLINK_GC_PLUGIN_GRAPH_WRITER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "Edge.h"
+#include "clang/Basic/SourceManager.h"
+#include "llvm/Support/raw_ostream.h"
+
+// The graph has a node for each class, and an edge for each of its bases and
+// for each class its fields point to, labelled by the field's name.
+//
+// The binary format is read by blink_gc_graph.py. After the magic "BGCGRAPH"
+// it is a stream of unsigned LEB128 varints, starting with the version of the
+// format, and then a record per string, node or edge:
+//
+//   kString  length, characters
+//   kNode    name, location
+//   kEdge    source, destination, label, liveness kind, pointer kind,
+//            location
+//
+// Strings are interned: each is written once, before the first record which
+// refers to it by its index among the strings. A location is either 0, if it
+// is invalid, or 1 + the index of its file name, followed by its line and
+// column.
+class GraphWriter {
+ public:
+  // How a field points to the class at the end of an edge.
+  enum PointerKind : uint8_t {
+    kValue,
+    kRawPointer,
+    kReference,
+    kRefPtr,
+    kUniquePtr,
+    kMember,
+  };
+
+  static std::unique_ptr<GraphWriter> CreateJson(
+      const clang::SourceManager& source_manager,
+      std::unique_ptr<llvm::raw_ostream> os);
+  static std::unique_ptr<GraphWriter> CreateBinary(
+      const clang::SourceManager& source_manager,
+      std::unique_ptr<llvm::raw_ostream> os);
+
+  // Finishes writing the graph.
+  virtual ~GraphWriter() = default;
+
+  virtual void WriteNode(const std::string& name,
+                         clang::SourceLocation loc) = 0;
+  virtual void WriteEdge(const std::string& src,
+                         const std::string& dst,
+                         const std::string& label,
+                         Edge::LivenessKind kind,
+                         PointerKind ptr,
+                         clang::SourceLocation loc) = 0;
+};
+
+#endif  // TOOLS_BLINK_GC_PLUGIN_GRAPH_WRITER_H_
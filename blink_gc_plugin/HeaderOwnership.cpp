@@ -0,0 +1,107 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "HeaderOwnership.h"
+
+#include <tuple>
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+
+namespace {
+
+const char* const kSourceExtensions[] = {".cc", ".cpp", ".mm"};
+
+std::string Normalize(llvm::StringRef path) {
+  llvm::SmallString<128> normalized(path);
+  llvm::sys::path::remove_dots(normalized, /*remove_dot_dot=*/true);
+  return std::string(normalized);
+}
+
+}  // namespace
+
+HeaderOwnership::HeaderOwnership(const SourceManager& source_manager,
+                                 const BlinkGCPluginOptions& options)
+    : source_manager_(source_manager) {
+  if (OptionalFileEntryRef main_file =
+          source_manager_.getFileEntryRefForID(
+              source_manager_.getMainFileID())) {
+    main_file_ = Normalize(main_file->getName());
+  }
+  if (!options.header_owners_file.empty())
+    ReadOwners(options.header_owners_file);
+}
+
+bool HeaderOwnership::IsOwned(const Decl* decl) {
+  if (decl->isTemplated())
+    return true;
+
+  SourceLocation loc = source_manager_.getExpansionLoc(decl->getLocation());
+  if (loc.isInvalid())
+    return true;
+  FileID file = source_manager_.getFileID(loc);
+  if (file == source_manager_.getMainFileID())
+    return true;
+
+  auto it = owned_.find(file);
+  if (it == owned_.end())
+    it = owned_.emplace(file, FileIsOwned(file)).first;
+  return it->second;
+}
+
+bool HeaderOwnership::FileIsOwned(FileID file) {
+  OptionalFileEntryRef entry = source_manager_.getFileEntryRefForID(file);
+  if (!entry)
+    return true;
+
+  std::string header = Normalize(entry->getName());
+  auto it = owners_.find(header);
+  if (it != owners_.end())
+    return it->second == main_file_;
+
+  // Textually included files other than headers, such as .inc files, have no
+  // source file of their own.
+  if (llvm::sys::path::extension(header) != ".h")
+    return true;
+
+  bool has_source = false;
+  for (const char* extension : kSourceExtensions) {
+    llvm::SmallString<128> source(header);
+    llvm::sys::path::replace_extension(source, extension);
+    if (source == main_file_)
+      return true;
+    has_source |= llvm::sys::fs::exists(source);
+  }
+  return !has_source;
+}
+
+// The header owners file has a line for each header, with the paths of the
+// header and of the main file of its owner separated by whitespace.
+void HeaderOwnership::ReadOwners(const std::string& filename) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer =
+      llvm::MemoryBuffer::getFile(filename);
+  if (!buffer) {
+    llvm::errs() << "[blink-gc] Failed to read the header owners file "
+                 << filename << ": " << buffer.getError().message() << "\n";
+    return;
+  }
+
+  llvm::StringRef contents = (*buffer)->getBuffer();
+  while (!contents.empty()) {
+    llvm::StringRef line;
+    std::tie(line, contents) = contents.split('\n');
+    line = line.trim();
+    if (line.empty() || line.starts_with("#"))
+      continue;
+    size_t separator = line.find_first_of(" \t");
+    if (separator == llvm::StringRef::npos)
+      continue;
+    owners_[Normalize(line.substr(0, separator))] =
+        Normalize(line.substr(separator).trim());
+  }
+}
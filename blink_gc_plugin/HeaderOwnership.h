@@ -0,0 +1,46 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file decides which translation unit checks the declarations of each
+// header, so that a header included by many translation units is checked by
+// only one of them.
+
+#ifndef TOOLS_BLINK_GC_PLUGIN_HEADER_OWNERSHIP_H_
+#define TOOLS_BLINK_GC_PLUGIN_HEADER_OWNERSHIP_H_
+
+#include <map>
+#include <string>
+
+#include "BlinkGCPluginOptions.h"
+#include "clang/AST/AST.h"
+#include "clang/Basic/SourceManager.h"
+
+// Each header is owned by one translation unit: the one the header owners file
+// maps it to, if any, or else the source file next to it with the same name,
+// e.g. node.cc for node.h. A header which has neither is owned by every
+// translation unit including it. Paths are compared as given to the compiler,
+// relative to the build directory, once their "." and ".." components have
+// been removed.
+class HeaderOwnership {
+ public:
+  HeaderOwnership(const clang::SourceManager& source_manager,
+                  const BlinkGCPluginOptions& options);
+
+  // Returns true if |decl| is to be checked by this translation unit. Templated
+  // declarations always are, since their instantiations depend on the
+  // translation unit.
+  bool IsOwned(const clang::Decl* decl);
+
+ private:
+  bool FileIsOwned(clang::FileID file);
+  void ReadOwners(const std::string& filename);
+
+  const clang::SourceManager& source_manager_;
+  std::string main_file_;
+  // Maps headers to the main files of their owners.
+  std::map<std::string, std::string> owners_;
+  std::map<clang::FileID, bool> owned_;
+};
+
+#endif  // TOOLS_BLINK_GC_PLUGIN_HEADER_OWNERSHIP_H_
@@ -67,13 +67,22 @@ class JsonWriter {
     state_.top() = true;
   }
   std::string Escape(const std::string& s) {
-    std::string copy = s;
-    size_t i = 0;
-    while ((i = copy.find('\\', i)) != std::string::npos) {
-      copy.replace(i, 1, "\\\\");
-      i += 2;
+    std::string escaped;
+    escaped.reserve(s.size());
+    for (char c : s) {
+      if (c == '"' || c == '\\') {
+        escaped += '\\';
+        escaped += c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        static const char kHexDigits[] = "0123456789abcdef";
+        escaped += "\\u00";
+        escaped += kHexDigits[c >> 4];
+        escaped += kHexDigits[c & 0xf];
+      } else {
+        escaped += c;
+      }
     }
-    return copy;
+    return escaped;
   }
   std::unique_ptr<llvm::raw_ostream> os_;
   std::stack<bool> state_;
@@ -18,11 +18,6 @@ RecordInfo::RecordInfo(CXXRecordDecl* record, RecordCache* cache)
       name_(record->getName()),
       fields_need_tracing_(TracingStatus::Unknown()) {}
 
-RecordInfo::~RecordInfo() {
-  delete fields_;
-  delete bases_;
-}
-
 bool RecordInfo::GetTemplateArgsInternal(
     const llvm::ArrayRef<clang::TemplateArgument>& args,
     size_t count,
@@ -247,11 +242,10 @@ RecordInfo* RecordCache::Lookup(CXXRecordDecl* record) {
   if (record->hasDefinition()) {
     record = record->getDefinition();
   }
-  Cache::iterator it = cache_.find(record);
-  if (it != cache_.end())
-    return &it->second;
-  return &cache_.insert(std::make_pair(record, RecordInfo(record, this)))
-              .first->second;
+  RecordInfo*& info = cache_[record];
+  if (!info)
+    info = new (allocator_.Allocate<RecordInfo>()) RecordInfo(record, this);
+  return info;
 }
 
 bool RecordInfo::HasTypeAlias(std::string marker_name) const {
@@ -419,9 +413,9 @@ bool RecordInfo::IsConsideredAbstract() {
   return true;
 }
 
-RecordInfo::Bases* RecordInfo::CollectBases() {
+RecordInfo::Bases RecordInfo::CollectBases() {
   // Compute the collection locally to avoid inconsistent states.
-  Bases* bases = new Bases;
+  Bases bases;
   if (!record_->hasDefinition())
     return bases;
   for (CXXRecordDecl::base_class_iterator it = record_->bases_begin();
@@ -435,7 +429,7 @@ RecordInfo::Bases* RecordInfo::CollectBases() {
     TracingStatus status = info->InheritsTrace()
                                ? TracingStatus::Needed()
                                : TracingStatus::Unneeded();
-    bases->push_back(std::make_pair(base, BasePoint(spec, info, status)));
+    bases.push_back(std::make_pair(base, BasePoint(spec, info, status)));
   }
   return bases;
 }
@@ -446,9 +440,9 @@ RecordInfo::Fields& RecordInfo::GetFields() {
   return *fields_;
 }
 
-RecordInfo::Fields* RecordInfo::CollectFields() {
+RecordInfo::Fields RecordInfo::CollectFields() {
   // Compute the collection locally to avoid inconsistent states.
-  Fields* fields = new Fields;
+  Fields fields;
   if (!record_->hasDefinition())
     return fields;
   TracingStatus fields_status = TracingStatus::Unneeded();
@@ -467,7 +461,7 @@ RecordInfo::Fields* RecordInfo::CollectFields() {
       edge = CreateEdge(field->getType().getTypePtrOrNull());
     if (edge) {
       fields_status = fields_status.LUB(edge->NeedsTracing(Edge::kRecursive));
-      fields->insert(std::make_pair(field, FieldPoint(field, edge)));
+      fields.insert(std::make_pair(field, FieldPoint(field, edge)));
     }
   }
   fields_need_tracing_ = fields_status;
@@ -640,7 +634,7 @@ Edge* RecordInfo::CreateEdgeFromOriginalType(const Type* type) {
   if (info) {
     on_heap = Config::IsGCCollection(info->name());
   }
-  return new Iterator(info, on_heap);
+  return cache_->NewEdge<Iterator>(info, on_heap);
 }
 
 Edge* RecordInfo::CreateEdge(const Type* type) {
@@ -650,13 +644,13 @@ Edge* RecordInfo::CreateEdge(const Type* type) {
 
   if (type->isPointerType() || type->isReferenceType()) {
     if (Edge* ptr = CreateEdge(type->getPointeeType().getTypePtrOrNull()))
-      return new RawPtr(ptr, type->isReferenceType());
+      return cache_->NewEdge<RawPtr>(ptr, type->isReferenceType());
     return 0;
   }
 
   if (type->isArrayType()) {
     if (Edge* ptr = CreateEdge(type->getPointeeOrArrayElementType())) {
-      return new ArrayEdge(ptr);
+      return cache_->NewEdge<ArrayEdge>(ptr);
     }
     return 0;
   }
@@ -672,7 +666,7 @@ Edge* RecordInfo::CreateEdge(const Type* type) {
 
   if (Config::IsRefOrWeakPtr(info->name()) && info->GetTemplateArgs(1, &args)) {
     if (Edge* ptr = CreateEdge(args[0]))
-      return new RefPtr(
+      return cache_->NewEdge<RefPtr>(
           ptr, Config::IsRefPtr(info->name()) ? Edge::kStrong : Edge::kWeak);
     return 0;
   }
@@ -685,7 +679,7 @@ Edge* RecordInfo::CreateEdge(const Type* type) {
     if (!isInStdNamespace(sema, ns))
       return 0;
     if (Edge* ptr = CreateEdge(args[0]))
-      return new UniquePtr(ptr);
+      return cache_->NewEdge<UniquePtr>(ptr);
     return 0;
   }
 
@@ -701,14 +695,14 @@ Edge* RecordInfo::CreateEdge(const Type* type) {
 
   if (Config::IsMember(info->name(), ns_name, info, &args)) {
     if (Edge* ptr = CreateEdge(args[0])) {
-      return new Member(ptr);
+      return cache_->NewEdge<Member>(ptr);
     }
     return 0;
   }
 
   if (Config::IsWeakMember(info->name(), ns_name, info, &args)) {
     if (Edge* ptr = CreateEdge(args[0]))
-      return new WeakMember(ptr);
+      return cache_->NewEdge<WeakMember>(ptr);
     return 0;
   }
 
@@ -717,9 +711,9 @@ Edge* RecordInfo::CreateEdge(const Type* type) {
       Config::IsCrossThreadPersistent(info->name(), ns_name, info, &args)) {
     if (Edge* ptr = CreateEdge(args[0])) {
       if (is_persistent)
-        return new Persistent(ptr);
+        return cache_->NewEdge<Persistent>(ptr);
       else
-        return new CrossThreadPersistent(ptr);
+        return cache_->NewEdge<CrossThreadPersistent>(ptr);
     }
     return 0;
   }
@@ -731,22 +725,23 @@ Edge* RecordInfo::CreateEdge(const Type* type) {
     size_t count = Config::CollectionDimension(info->name());
     if (!info->GetTemplateArgs(count, &args))
       return 0;
-    Collection* edge = new Collection(info, on_heap);
+    llvm::SmallVector<Edge*, 4> members;
     for (TemplateArgs::iterator it = args.begin(); it != args.end(); ++it) {
       if (Edge* member = CreateEdge(*it)) {
-        edge->members().push_back(member);
+        members.push_back(member);
       }
       // TODO: Handle the case where we fail to create an edge (eg, if the
       // argument is a primitive type or just not fully known yet).
     }
-    return edge;
+    return cache_->NewEdge<Collection>(info, on_heap,
+                                       cache_->CopyMembers(members));
   }
 
   if (Config::IsTraceWrapperV8Reference(info->name(), ns_name, info, &args)) {
     if (Edge* ptr = CreateEdge(args[0]))
-      return new TraceWrapperV8Reference(ptr);
+      return cache_->NewEdge<TraceWrapperV8Reference>(ptr);
     return 0;
   }
 
-  return new Value(info);
+  return cache_->NewEdge<Value>(info);
 }
@@ -9,7 +9,8 @@
 #ifndef TOOLS_BLINK_GC_PLUGIN_RECORD_INFO_H_
 #define TOOLS_BLINK_GC_PLUGIN_RECORD_INFO_H_
 
-#include <map>
+#include <optional>
+#include <utility>
 #include <vector>
 
 #include "Edge.h"
@@ -17,6 +18,9 @@
 #include "clang/AST/AST.h"
 #include "clang/AST/CXXInheritance.h"
 #include "clang/Frontend/CompilerInstance.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/Support/Allocator.h"
 
 class RecordCache;
 
@@ -63,27 +67,17 @@ class FieldPoint : public GraphPoint {
  private:
   clang::FieldDecl* field_;
   Edge* edge_;
-
-  friend class RecordCache;
-  void deleteEdge() { delete edge_; }
 };
 
 // Wrapper class to lazily collect information about a C++ record.
 class RecordInfo {
  public:
   typedef std::vector<std::pair<clang::CXXRecordDecl*, BasePoint>> Bases;
-
-  struct FieldDeclCmp {
-    bool operator()(clang::FieldDecl* a, clang::FieldDecl *b) const {
-      return a->getBeginLoc() < b->getBeginLoc();
-    }
-  };
-  typedef std::map<clang::FieldDecl*, FieldPoint, FieldDeclCmp> Fields;
+  // The fields in declaration order.
+  typedef llvm::MapVector<clang::FieldDecl*, FieldPoint> Fields;
 
   typedef std::vector<const clang::Type*> TemplateArgs;
 
-  ~RecordInfo();
-
   clang::CXXRecordDecl* record() const { return record_; }
   const std::string& name() const { return name_; }
   Fields& GetFields();
@@ -122,8 +116,8 @@ class RecordInfo {
 
   void walkBases();
 
-  Fields* CollectFields();
-  Bases* CollectBases();
+  Fields CollectFields();
+  Bases CollectBases();
   void DetermineTracingMethods();
   bool InheritsTrace();
 
@@ -142,8 +136,8 @@ class RecordInfo {
   clang::CXXRecordDecl* record_;
   const std::string name_;
   TracingStatus fields_need_tracing_;
-  Bases* bases_ = nullptr;
-  Fields* fields_ = nullptr;
+  std::optional<Bases> bases_;
+  std::optional<Fields> fields_;
 
   enum CachedBool { kFalse = 0, kTrue = 1, kNotComputed = 2 };
   CachedBool is_stack_allocated_ = kNotComputed;
@@ -193,23 +187,31 @@ class RecordCache {
   }
 
   ~RecordCache() {
-    for (Cache::iterator it = cache_.begin(); it != cache_.end(); ++it) {
-      if (!it->second.fields_)
-        continue;
-      for (RecordInfo::Fields::iterator fit = it->second.fields_->begin();
-        fit != it->second.fields_->end();
-        ++fit) {
-        fit->second.deleteEdge();
-      }
-    }
+    for (auto& entry : cache_)
+      entry.second->~RecordInfo();
   }
 
   clang::CompilerInstance& instance() const { return instance_; }
 
+  // Allocates an edge, which lives as long as the cache.
+  template <typename T, typename... Args>
+  T* NewEdge(Args&&... args) {
+    return new (allocator_.Allocate<T>()) T(std::forward<Args>(args)...);
+  }
+
+  // Copies |members| into memory which lives as long as the cache.
+  Collection::Members CopyMembers(Collection::Members members) {
+    return members.copy(allocator_);
+  }
+
  private:
   clang::CompilerInstance& instance_;
 
-  typedef std::map<clang::CXXRecordDecl*, RecordInfo> Cache;
+  // The records, edges and collection members of the translation unit, which
+  // are freed together when the cache is destroyed.
+  llvm::BumpPtrAllocator allocator_;
+
+  typedef llvm::DenseMap<clang::CXXRecordDecl*, RecordInfo*> Cache;
   Cache cache_;
 };
 
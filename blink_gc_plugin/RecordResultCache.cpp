@@ -0,0 +1,350 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "RecordResultCache.h"
+
+#include <algorithm>
+
+#include "RecordInfo.h"
+#include "clang/Basic/Version.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+
+namespace {
+
+// Bump this whenever a change to the plugin changes the results of its checks,
+// so that results cached by an older plugin are not used.
+const char kCacheVersion[] = "1";
+
+void AddString(llvm::MD5* hash, llvm::StringRef str) {
+  hash->update(str);
+  // Keeps consecutive strings from running into each other.
+  hash->update(llvm::StringRef("", 1));
+}
+
+std::string GetDigest(llvm::MD5* hash) {
+  llvm::MD5::MD5Result result;
+  hash->final(result);
+  return std::string(result.digest());
+}
+
+// The ODR hash of a class template specialization, or of a class nested in
+// one, does not cover its contents.
+bool InSpecialization(const DeclContext* context) {
+  for (; context; context = context->getParent()) {
+    if (isa<ClassTemplateSpecializationDecl>(context))
+      return true;
+  }
+  return false;
+}
+
+void AddAnnotations(llvm::MD5* hash, const Decl* decl) {
+  for (const auto* attr : decl->specific_attrs<AnnotateAttr>())
+    AddString(hash, attr->getAnnotation());
+}
+
+void AddBody(llvm::MD5* hash, FunctionDecl* function) {
+  FunctionDecl* definition = function ? function->getDefinition() : nullptr;
+  if (!definition) {
+    AddString(hash, "");
+    return;
+  }
+  AddString(hash, std::to_string(definition->getODRHash()));
+}
+
+}  // namespace
+
+RecordResultCache::RecordResultCache(CompilerInstance& instance,
+                                     RecordCache* cache,
+                                     const BlinkGCPluginOptions& options)
+    : instance_(instance),
+      cache_(cache),
+      directory_(options.result_cache_dir) {
+  llvm::MD5 hash;
+  AddString(&hash, kCacheVersion);
+  AddString(&hash, getClangFullVersion());
+  for (bool flag : {options.enable_persistent_in_unique_ptr_check,
+                    options.enable_members_on_stack_check,
+                    options.enable_extra_padding_check,
+                    options.enable_off_heap_collections_of_gced_check,
+                    options.enable_ptrs_to_traceable_check}) {
+    AddString(&hash, flag ? "1" : "0");
+  }
+  for (const auto& name : options.ignored_classes)
+    AddString(&hash, name);
+  AddString(&hash, "");
+  for (const auto& name : options.checked_namespaces)
+    AddString(&hash, name);
+  AddString(&hash, "");
+  for (const auto& dir : options.checked_directories)
+    AddString(&hash, dir);
+  AddString(&hash, "");
+  for (const auto& dir : options.ignored_directories)
+    AddString(&hash, dir);
+  options_hash_ = GetDigest(&hash);
+}
+
+bool RecordResultCache::IsVerified(CXXRecordDecl* record) {
+  auto start = std::chrono::steady_clock::now();
+  std::string entry_name = GetEntryName(record);
+  bool verified = false;
+  if (!entry_name.empty()) {
+    verified = llvm::sys::fs::exists(GetEntryPath(entry_name));
+    ++(verified ? hits_ : misses_);
+  }
+  time_ += std::chrono::steady_clock::now() - start;
+  return verified;
+}
+
+void RecordResultCache::MarkVerified(CXXRecordDecl* record) {
+  auto start = std::chrono::steady_clock::now();
+  std::string entry_name = GetEntryName(record);
+  time_ += std::chrono::steady_clock::now() - start;
+  if (entry_name.empty())
+    return;
+
+  // The cache is only an optimization, so failing to write to it is harmless.
+  std::string path = GetEntryPath(entry_name);
+  if (llvm::sys::fs::create_directories(llvm::sys::path::parent_path(path)))
+    return;
+  std::error_code err;
+  llvm::raw_fd_ostream entry(path, err, llvm::sys::fs::OF_None);
+  if (!err) {
+    entry << nodes_[record->getDefinition()].name << "\n";
+    ++added_;
+  }
+}
+
+void RecordResultCache::PrintStats(llvm::raw_ostream& os) const {
+  double ms = std::chrono::duration<double, std::milli>(time_).count();
+  os << "[blink-gc] Result cache: " << hits_ << " hits, " << misses_
+     << " misses, " << added_ << " added, " << llvm::format("%.3f", ms)
+     << " ms\n";
+}
+
+std::string RecordResultCache::GetEntryName(CXXRecordDecl* record) {
+  // Records of the main file are only ever checked by this translation unit.
+  const SourceManager& source_manager = instance_.getSourceManager();
+  if (source_manager.isInMainFile(
+          source_manager.getExpansionLoc(record->getLocation()))) {
+    return "";
+  }
+
+  CXXRecordDecl* definition = record->getDefinition();
+  if (!definition)
+    return "";
+  auto it = nodes_.find(definition);
+  Node& node = it != nodes_.end() ? it->second : Visit(definition);
+  if (!node.cacheable)
+    return "";
+
+  llvm::MD5 hash;
+  AddString(&hash, node.name);
+  AddString(&hash, node.fingerprint);
+  return GetDigest(&hash);
+}
+
+std::string RecordResultCache::GetEntryPath(const std::string& entry_name) {
+  // Entries are spread over subdirectories to keep directories small.
+  llvm::SmallString<128> path(directory_);
+  llvm::sys::path::append(path, entry_name.substr(0, 2), entry_name.substr(2));
+  return std::string(path);
+}
+
+// Computes the fingerprints of |record| and of every record it depends on
+// which has none yet, using Tarjan's algorithm to find the strongly connected
+// components of the dependency graph. The records of a component depend on
+// each other, so they share a fingerprint, which covers the records of the
+// component and the fingerprints of the components they depend on.
+RecordResultCache::Node& RecordResultCache::Visit(CXXRecordDecl* record) {
+  Node& node = nodes_[record];
+  node.index = node.low_link = next_index_++;
+  node.on_stack = true;
+  stack_.push_back(record);
+  ComputeLocalHash(record, &node);
+
+  for (CXXRecordDecl* dependency : node.dependencies) {
+    auto it = nodes_.find(dependency);
+    if (it == nodes_.end()) {
+      Node& child = Visit(dependency);
+      node.low_link = std::min(node.low_link, child.low_link);
+    } else if (it->second.on_stack) {
+      node.low_link = std::min(node.low_link, it->second.index);
+    }
+  }
+  if (node.low_link != node.index)
+    return node;
+
+  std::vector<Node*> component;
+  CXXRecordDecl* member;
+  do {
+    member = stack_.back();
+    stack_.pop_back();
+    Node& member_node = nodes_[member];
+    member_node.on_stack = false;
+    component.push_back(&member_node);
+  } while (member != record);
+
+  // The records outside the component which its records depend on already
+  // have fingerprints. The fingerprint must not depend on the order in which
+  // the records were visited, so both lists are sorted.
+  bool cacheable = true;
+  std::vector<std::string> members;
+  std::vector<std::string> successors;
+  for (Node* member_node : component) {
+    cacheable &= member_node->cacheable;
+    members.push_back(member_node->name + '\n' + member_node->local_hash);
+    for (CXXRecordDecl* dependency : member_node->dependencies) {
+      Node& dependency_node = nodes_[dependency];
+      if (dependency_node.fingerprint.empty())
+        continue;
+      cacheable &= dependency_node.cacheable;
+      successors.push_back(dependency_node.fingerprint);
+    }
+  }
+  std::sort(members.begin(), members.end());
+  std::sort(successors.begin(), successors.end());
+  successors.erase(std::unique(successors.begin(), successors.end()),
+                   successors.end());
+
+  llvm::MD5 hash;
+  AddString(&hash, options_hash_);
+  for (const auto& str : members)
+    AddString(&hash, str);
+  AddString(&hash, "");
+  for (const auto& str : successors)
+    AddString(&hash, str);
+  std::string fingerprint = GetDigest(&hash);
+  for (Node* member_node : component) {
+    member_node->fingerprint = fingerprint;
+    member_node->cacheable = cacheable;
+  }
+  return node;
+}
+
+void RecordResultCache::ComputeLocalHash(CXXRecordDecl* record, Node* node) {
+  node->name = GetName(record);
+
+  // Template instantiations are hashed by their pattern, along with their
+  // name, which spells out the template arguments.
+  CXXRecordDecl* pattern = record;
+  if (isTemplateInstantiation(record->getTemplateSpecializationKind()))
+    pattern = record->getTemplateInstantiationPattern();
+  if (pattern)
+    pattern = pattern->getDefinition();
+  if (!pattern || record->isLambda() || InSpecialization(pattern)) {
+    node->cacheable = false;
+    return;
+  }
+
+  llvm::MD5 hash;
+  AddString(&hash, std::to_string(pattern->getODRHash()));
+
+  // The ODR hash does not cover attributes, such as GC_PLUGIN_IGNORE.
+  AddAnnotations(&hash, pattern);
+  for (const Decl* decl : pattern->decls())
+    AddAnnotations(&hash, decl);
+
+  // The checks of garbage collected classes look into their destructor and
+  // dispatch methods, if this translation unit defines them.
+  RecordInfo* info = cache_->Lookup(record);
+  if (info && info->IsGCDerived()) {
+    AddBody(&hash, record->getDestructor());
+    AddBody(&hash, info->GetTraceDispatchMethod());
+    AddBody(&hash, info->GetFinalizeDispatchMethod());
+  }
+
+  for (const CXXBaseSpecifier& base : record->bases())
+    AddTypeDependencies(base.getType(), node, &hash);
+  for (FieldDecl* field : record->fields())
+    AddTypeDependencies(field->getType(), node, &hash);
+  if (auto* specialization =
+          dyn_cast<ClassTemplateSpecializationDecl>(record)) {
+    for (const TemplateArgument& arg :
+         specialization->getTemplateArgs().asArray()) {
+      AddTemplateArgumentDependencies(arg, node, &hash);
+    }
+  }
+
+  node->local_hash = GetDigest(&hash);
+}
+
+void RecordResultCache::AddTemplateArgumentDependencies(
+    const TemplateArgument& arg,
+    Node* node,
+    llvm::MD5* hash) {
+  if (arg.getKind() == TemplateArgument::Type) {
+    AddTypeDependencies(arg.getAsType(), node, hash);
+  } else if (arg.getKind() == TemplateArgument::Pack) {
+    for (const TemplateArgument& pack_arg : arg.getPackAsArray())
+      AddTemplateArgumentDependencies(pack_arg, node, hash);
+  }
+}
+
+// Adds the records which a field or base of type |type| refers to, which are
+// the ones RecordInfo creates edges to, along with the qualifier of an
+// iterator type.
+void RecordResultCache::AddTypeDependencies(QualType type,
+                                            Node* node,
+                                            llvm::MD5* hash) {
+  if (type.isNull())
+    return;
+
+  if (const auto* elaborated = dyn_cast<ElaboratedType>(type.getTypePtr())) {
+    if (const NestedNameSpecifier* qualifier = elaborated->getQualifier()) {
+      if (const Type* qualifier_type = qualifier->getAsType())
+        AddTypeDependencies(QualType(qualifier_type, 0), node, hash);
+    }
+  }
+
+  const Type* canonical = type.getCanonicalType().getTypePtr();
+  if (canonical->isPointerType() || canonical->isReferenceType()) {
+    AddTypeDependencies(canonical->getPointeeType(), node, hash);
+    return;
+  }
+  if (canonical->isArrayType()) {
+    AddTypeDependencies(QualType(canonical->getPointeeOrArrayElementType(), 0),
+                        node, hash);
+    return;
+  }
+  if (const auto* specialization =
+          canonical->getAs<TemplateSpecializationType>()) {
+    // A dependent specialization depends on its primary template, unless it
+    // names a template template parameter.
+    if (auto* tmpl = dyn_cast_or_null<ClassTemplateDecl>(
+            specialization->getTemplateName().getAsTemplateDecl())) {
+      AddRecordDependency(tmpl->getTemplatedDecl(), node, hash);
+    }
+    for (const TemplateArgument& arg : specialization->template_arguments())
+      AddTemplateArgumentDependencies(arg, node, hash);
+    return;
+  }
+  AddRecordDependency(canonical->getAsCXXRecordDecl(), node, hash);
+}
+
+void RecordResultCache::AddRecordDependency(CXXRecordDecl* record,
+                                            Node* node,
+                                            llvm::MD5* hash) {
+  if (!record)
+    return;
+  if (CXXRecordDecl* definition = record->getDefinition()) {
+    node->dependencies.push_back(definition);
+    return;
+  }
+  // Whether a record is complete matters to the checks, but an incomplete
+  // record has nothing else to hash.
+  AddString(hash, GetName(record));
+}
+
+std::string RecordResultCache::GetName(const NamedDecl* decl) {
+  std::string name;
+  llvm::raw_string_ostream os(name);
+  decl->getNameForDiagnostic(os, instance_.getASTContext().getPrintingPolicy(),
+                             /*Qualified=*/true);
+  return os.str();
+}
@@ -0,0 +1,97 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file provides an on-disk cache of the records which have been checked
+// without diagnostics, so that translation units including the same header
+// need not check its classes again.
+
+#ifndef TOOLS_BLINK_GC_PLUGIN_RECORD_RESULT_CACHE_H_
+#define TOOLS_BLINK_GC_PLUGIN_RECORD_RESULT_CACHE_H_
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "BlinkGCPluginOptions.h"
+#include "clang/AST/AST.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/raw_ostream.h"
+
+class RecordCache;
+
+// Each entry of the cache is an empty file in the cache directory, named by a
+// hash of a record's name and of its fingerprint. The fingerprint covers
+// everything the record checks read: the record's definition, the bodies of
+// its destructor and dispatch methods if they are defined in this translation
+// unit, the plugin options, and the same for every record its bases and
+// fields refer to, transitively. A record which changes in any of these, or
+// which is checked with different options, thus misses the cache.
+//
+// Entries are only ever added, by whichever translation unit first checks a
+// record clean, so concurrent compilations can share a cache directory.
+class RecordResultCache {
+ public:
+  RecordResultCache(clang::CompilerInstance& instance,
+                    RecordCache* cache,
+                    const BlinkGCPluginOptions& options);
+
+  // Returns true if |record| has been checked without diagnostics before.
+  bool IsVerified(clang::CXXRecordDecl* record);
+
+  // Records that |record| has been checked without diagnostics.
+  void MarkVerified(clang::CXXRecordDecl* record);
+
+  // Prints the number of records which hit the cache, missed it and were added
+  // to it, and the time spent computing their entries and looking them up.
+  void PrintStats(llvm::raw_ostream& os) const;
+
+ private:
+  // The dependency graph of the records, whose strongly connected components
+  // share a fingerprint.
+  struct Node {
+    std::string name;
+    std::string local_hash;
+    std::vector<clang::CXXRecordDecl*> dependencies;
+    bool cacheable = true;
+
+    unsigned index = 0;
+    unsigned low_link = 0;
+    bool on_stack = false;
+    std::string fingerprint;
+  };
+
+  // Returns the name of the cache entry for |record|, or an empty string if
+  // the record cannot be cached.
+  std::string GetEntryName(clang::CXXRecordDecl* record);
+  std::string GetEntryPath(const std::string& entry_name);
+
+  Node& Visit(clang::CXXRecordDecl* record);
+  void ComputeLocalHash(clang::CXXRecordDecl* record, Node* node);
+  void AddTemplateArgumentDependencies(const clang::TemplateArgument& arg,
+                                       Node* node,
+                                       llvm::MD5* hash);
+  void AddTypeDependencies(clang::QualType type, Node* node, llvm::MD5* hash);
+  void AddRecordDependency(clang::CXXRecordDecl* record,
+                           Node* node,
+                           llvm::MD5* hash);
+  std::string GetName(const clang::NamedDecl* decl);
+
+  clang::CompilerInstance& instance_;
+  RecordCache* cache_;
+  std::string directory_;
+  std::string options_hash_;
+
+  std::map<clang::CXXRecordDecl*, Node> nodes_;
+  std::vector<clang::CXXRecordDecl*> stack_;
+  unsigned next_index_ = 0;
+
+  unsigned hits_ = 0;
+  unsigned misses_ = 0;
+  unsigned added_ = 0;
+  std::chrono::steady_clock::duration time_{};
+};
+
+#endif  // TOOLS_BLINK_GC_PLUGIN_RECORD_RESULT_CACHE_H_
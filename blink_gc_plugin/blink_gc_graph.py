@@ -0,0 +1,99 @@
+# Copyright 2026 The Chromium Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+"""Reads the points-to graphs dumped by the Blink GC plugin.
+
+The plugin writes a graph per translation unit, either as a .graph.json file
+or, with the dump-binary-graph option, as a .graph.bin file in the format
+described in GraphWriter.h. read_graph() reads either, as the list of node and
+edge entries of the JSON format.
+"""
+
+import json
+
+_MAGIC = b'BGCGRAPH'
+_VERSION = 1
+
+_STRING = 1
+_NODE = 2
+_EDGE = 3
+
+# The names of GraphWriter::PointerKind.
+_POINTER_KINDS = ('val', 'raw', 'reference', 'ref', 'unique', 'mem')
+
+
+class GraphFormatError(Exception):
+  pass
+
+
+def is_binary_graph(filename):
+  with open(filename, 'rb') as f:
+    return f.read(len(_MAGIC)) == _MAGIC
+
+
+def read_graph(filename):
+  """Returns the entries of the graph in |filename|, in either format."""
+  if is_binary_graph(filename):
+    with open(filename, 'rb') as f:
+      return list(_read_binary_graph(f.read()))
+  with open(filename) as f:
+    return json.load(f)
+
+
+def _read_binary_graph(data):
+  pos = len(_MAGIC)
+
+  def read_varint():
+    nonlocal pos
+    value = 0
+    shift = 0
+    while True:
+      if pos >= len(data):
+        raise GraphFormatError('Truncated graph')
+      byte = data[pos]
+      pos += 1
+      value |= (byte & 0x7f) << shift
+      if byte < 0x80:
+        return value
+      shift += 7
+
+  def read_location():
+    file_index = read_varint()
+    if not file_index:
+      return ''
+    line = read_varint()
+    column = read_varint()
+    return '%s:%d:%d' % (strings[file_index - 1], line, column)
+
+  version = read_varint()
+  if version != _VERSION:
+    raise GraphFormatError('Unsupported graph version %d' % version)
+
+  strings = []
+  while pos < len(data):
+    record = read_varint()
+    if record == _STRING:
+      length = read_varint()
+      if pos + length > len(data):
+        raise GraphFormatError('Truncated graph')
+      strings.append(data[pos:pos + length].decode('utf-8'))
+      pos += length
+    elif record == _NODE:
+      name = strings[read_varint()]
+      yield {'name': name, 'loc': read_location()}
+    elif record == _EDGE:
+      src = strings[read_varint()]
+      dst = strings[read_varint()]
+      lbl = strings[read_varint()]
+      kind = read_varint()
+      ptr = _POINTER_KINDS[read_varint()]
+      yield {
+          'src': src,
+          'dst': dst,
+          'lbl': lbl,
+          'kind': kind,
+          'loc': read_location(),
+          'ptr': ptr,
+      }
+    else:
+      raise GraphFormatError('Unknown record %d' % record)
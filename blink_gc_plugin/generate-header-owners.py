@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+# Copyright 2026 The Chromium Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+"""Generates the file given to the Blink GC plugin's header-owners option.
+
+Reads the .filepaths files which tools/clang/translation_unit writes for each
+translation unit, and picks an owner for every header they include: the
+translation unit with the same name as the header if it includes it, or else
+the first one including it. Run it from the build directory the tool was run
+in, so that the paths are relative to it as the plugin expects.
+"""
+
+import argparse
+import os
+import sys
+
+SOURCE_EXTENSIONS = ('.cc', '.cpp', '.mm')
+FILEPATHS_EXTENSION = '.filepaths'
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__)
+  parser.add_argument('-o',
+                      '--output',
+                      default=None,
+                      metavar='FILE',
+                      help='File to write the header owners to')
+  parser.add_argument('files',
+                      metavar='FILEPATHS',
+                      nargs='+',
+                      help='.filepaths files of the translation units')
+  args = parser.parse_args()
+
+  includers = {}
+  for filepaths in args.files:
+    if not filepaths.endswith(FILEPATHS_EXTENSION):
+      sys.stderr.write('Not a .filepaths file: %s\n' % filepaths)
+      return 1
+    main_file = os.path.normpath(filepaths[:-len(FILEPATHS_EXTENSION)])
+    with open(filepaths) as f:
+      for line in f:
+        path = os.path.normpath(line.strip())
+        if os.path.splitext(path)[1] == '.h':
+          includers.setdefault(path, set()).add(main_file)
+
+  out = open(args.output, 'w') if args.output else sys.stdout
+  for header in sorted(includers):
+    main_files = includers[header]
+    stem = os.path.splitext(header)[0]
+    owner = next((stem + extension for extension in SOURCE_EXTENSIONS
+                  if stem + extension in main_files), min(main_files))
+    out.write('%s %s\n' % (header, owner))
+  if out is not sys.stdout:
+    out.close()
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -4,7 +4,9 @@
 # found in the LICENSE file.
 
 from __future__ import print_function
-import argparse, os, sys, json, subprocess, pickle
+import argparse, os, sys, pickle
+
+import blink_gc_graph
 
 try:
   from StringIO import StringIO  # Python 2
@@ -17,7 +19,7 @@ parser = argparse.ArgumentParser(
 
 parser.add_argument(
   '-', dest='use_stdin', action='store_true',
-  help='Read JSON graph files from stdin')
+  help='Read graph files from stdin')
 
 parser.add_argument(
   '-c', '--detect-cycles', action='store_true',
@@ -45,7 +47,7 @@ parser.add_argument(
 
 parser.add_argument(
   'files', metavar='FILE_OR_DIR', nargs='*', default=[],
-  help='JSON graph files or directories containing them')
+  help='Graph files or directories containing them')
 
 # Command line args after parsing.
 args = None
@@ -168,18 +170,16 @@ class Edge:
     return self.lbl.startswith('<super>')
 
 def parse_file(filename):
-  obj = json.load(open(filename))
-  return obj
+  return blink_gc_graph.read_graph(filename)
 
 def build_graphs_in_dir(dirname):
-  # TODO: Use plateform independent code, eg, os.walk
-  files = subprocess.check_output(
-    ['find', dirname, '-name', '*.graph.json']).split('\n')
+  files = []
+  for root, _, filenames in os.walk(dirname):
+    for f in filenames:
+      if f.endswith('.graph.json') or f.endswith('.graph.bin'):
+        files.append(os.path.join(root, f))
   log("Found %d files" % len(files))
   for f in files:
-    f.strip()
-    if len(f) < 1:
-      continue
     build_graph(f)
 
 def build_graph(filename):
@@ -0,0 +1,17 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "binary_graph.h"
+
+namespace blink {
+
+void A::Trace(Visitor* visitor) const {
+  visitor->Trace(m_c);
+}
+
+void B::Trace(Visitor* visitor) const {
+  A::Trace(visitor);
+}
+
+}  // namespace blink
@@ -0,0 +1,37 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BINARY_GRAPH_H_
+#define BINARY_GRAPH_H_
+
+#include "heap/stubs.h"
+
+namespace blink {
+
+class C;
+
+// This contains a leaking cycle, dumped in the binary format:
+// C -per-> B -sup-> A -ref-> C
+
+class A : public GarbageCollected<A> {
+ public:
+  virtual void Trace(Visitor*) const;
+
+ private:
+  scoped_refptr<C> m_c;
+};
+
+class B : public A {
+ public:
+  void Trace(Visitor*) const override;
+};
+
+class C : public RefCounted<C> {
+ private:
+  Persistent<B> m_b;
+};
+
+}  // namespace blink
+
+#endif  // BINARY_GRAPH_H_
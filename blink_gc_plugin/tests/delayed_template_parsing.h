@@ -0,0 +1,28 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DELAYED_TEMPLATE_PARSING_H_
+#define DELAYED_TEMPLATE_PARSING_H_
+
+#include "heap/stubs.h"
+
+namespace blink {
+
+class GCed : public GarbageCollected<GCed> {
+ public:
+  void Trace(Visitor*) const {}
+};
+
+template <typename T>
+class Holder : public GarbageCollected<Holder<T>> {
+ public:
+  void Trace(Visitor*) const;
+
+ private:
+  Member<T> obj_;
+};
+
+}  // namespace blink
+
+#endif  // DELAYED_TEMPLATE_PARSING_H_
@@ -0,0 +1,15 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "owner_tu.h"
+#include "owner_tu_other.h"
+
+namespace blink {
+
+class MainFileObject : public GarbageCollected<MainFileObject> {
+private:
+    OtherPart<MainFileObject> m_part;
+};
+
+} // namespace blink
@@ -0,0 +1,20 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef OWNER_TU_H_
+#define OWNER_TU_H_
+
+#include "heap/stubs.h"
+
+namespace blink {
+
+// This header is owned by owner_tu.cpp, which has the same name.
+class OwnedObject : public GarbageCollected<OwnedObject> {
+private:
+    Member<OwnedObject> m_obj;
+};
+
+}
+
+#endif
@@ -0,0 +1,13 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "owner_tu_default.h"
+#include "owner_tu.h"
+#include "owner_tu_other.h"
+
+// Without a header owners file, each header is owned by the source file with
+// the same name next to it, as found from the working directory. owner_tu.h is
+// owned by owner_tu.cpp, so its classes are not checked here. There is no
+// source file next to owner_tu_other.h, so its classes are checked by every
+// translation unit including it.
@@ -0,0 +1,20 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef OWNER_TU_DEFAULT_H_
+#define OWNER_TU_DEFAULT_H_
+
+#include "heap/stubs.h"
+
+namespace blink {
+
+// This header is owned by owner_tu_default.cpp, which has the same name.
+class DefaultOwnedObject : public GarbageCollected<DefaultOwnedObject> {
+private:
+    Member<DefaultOwnedObject> m_obj;
+};
+
+}
+
+#endif
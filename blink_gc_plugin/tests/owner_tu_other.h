@@ -0,0 +1,30 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef OWNER_TU_OTHER_H_
+#define OWNER_TU_OTHER_H_
+
+#include "heap/stubs.h"
+
+namespace blink {
+
+// owner_tu.owners gives this header another owner, so owner_tu.cpp does not
+// check its classes. Without it, every translation unit including it does.
+class OtherObject : public GarbageCollected<OtherObject> {
+private:
+    Member<OtherObject> m_obj;
+};
+
+// Instantiations of templates are checked by every translation unit, since
+// they depend on the template arguments.
+template <typename T>
+class OtherPart {
+    DISALLOW_NEW();
+private:
+    Member<T> m_obj;
+};
+
+}
+
+#endif
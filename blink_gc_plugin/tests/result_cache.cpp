@@ -0,0 +1,18 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "result_cache.h"
+
+namespace blink {
+
+void HeapObject::Trace(Visitor* visitor) const {
+  visitor->Trace(m_obj);
+}
+
+class MainFileObject : public GarbageCollected<MainFileObject> {
+private:
+    Member<HeapHolder<HeapObject>> m_holder;
+};
+
+} // namespace blink
@@ -0,0 +1,36 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef RESULT_CACHE_H_
+#define RESULT_CACHE_H_
+
+#include "heap/stubs.h"
+
+namespace blink {
+
+class HeapObject : public GarbageCollected<HeapObject> {
+public:
+    void Trace(Visitor*) const;
+private:
+    Member<HeapObject> m_obj;
+};
+
+template <typename T>
+class HeapHolder : public GarbageCollected<HeapHolder<T>> {
+public:
+    void Trace(Visitor* visitor) const { visitor->Trace(m_obj); }
+private:
+    Member<T> m_obj;
+};
+
+// Classes with diagnostics are never cached, so these are reported on every
+// run, whether or not the cache is warm.
+class UntracedObject : public GarbageCollected<UntracedObject> {
+private:
+    Member<HeapObject> m_obj;
+};
+
+}
+
+#endif
@@ -5,8 +5,11 @@
 
 import argparse
 import os
+import re
+import shutil
 import subprocess
 import sys
+import tempfile
 
 script_dir = os.path.dirname(os.path.realpath(__file__))
 tool_dir = os.path.abspath(os.path.join(script_dir, '../../pylib'))
@@ -14,6 +17,11 @@ sys.path.insert(0, tool_dir)
 
 from clang import plugin_testing
 
+_RESULT_CACHE_DIR_ARG = 'result-cache-dir='
+_RESULT_CACHE_STATS_RE = re.compile(
+    r'^\[blink-gc\] Result cache: (\d+) hits, (\d+) misses, (\d+) added, '
+    r'[\d.]+ ms\n', re.MULTILINE)
+
 
 class BlinkGcPluginTest(plugin_testing.ClangPluginTest):
   """Test harness for the Blink GC plugin."""
@@ -24,26 +32,75 @@ class BlinkGcPluginTest(plugin_testing.ClangPluginTest):
   def AdjustClangArguments(self, clang_cmd):
     clang_cmd.append('-Wno-inaccessible-base')
 
+  def RunOneTest(self, test_name, cmd):
+    if not any(arg.startswith(_RESULT_CACHE_DIR_ARG) for arg in cmd):
+      return super(BlinkGcPluginTest, self).RunOneTest(test_name, cmd)
+
+    # A test of the result cache is compiled twice with a fresh cache
+    # directory, whichever one its flags name. The first compile must miss the
+    # cache and fill it, and the second must find every class the first added,
+    # and report the same diagnostics, which are the results of the test.
+    cache_dir = tempfile.mkdtemp()
+    try:
+      cmd = [
+          _RESULT_CACHE_DIR_ARG + cache_dir
+          if arg.startswith(_RESULT_CACHE_DIR_ARG) else arg for arg in cmd
+      ]
+      cmd += [
+          '-Xclang', '-plugin-arg-blink-gc-plugin', '-Xclang',
+          'print-result-cache-stats'
+      ]
+      outputs = []
+      stats = []
+      for _ in range(2):
+        output = self._Compile(cmd)
+        match = _RESULT_CACHE_STATS_RE.search(output)
+        if not match:
+          return 'no result cache stats in output:\n' + output
+        outputs.append(_RESULT_CACHE_STATS_RE.sub('', output))
+        stats.append([int(count) for count in match.groups()])
+    finally:
+      shutil.rmtree(cache_dir)
+
+    (cold_hits, _, cold_added), (warm_hits, _, warm_added) = stats
+    if cold_hits or not cold_added:
+      return 'first compile hit the cache or added nothing to it: %s' % stats[0]
+    if warm_hits != cold_added or warm_added:
+      return ('second compile did not skip the classes the first added: %s' %
+              stats[1])
+    if outputs[0] != outputs[1]:
+      return 'compiles with a cold and a warm cache differed:\n' + outputs[0]
+    return self.ProcessOneResult(test_name, outputs[1])
+
+  def _Compile(self, cmd):
+    try:
+      return subprocess.check_output(cmd,
+                                     stderr=subprocess.STDOUT,
+                                     universal_newlines=True)
+    except subprocess.CalledProcessError as e:
+      return e.output
+
   def ProcessOneResult(self, test_name, actual):
-    # Some Blink GC plugins dump a JSON representation of the object graph, and
-    # use the processed results as the actual results of the test.
-    if os.path.exists('%s.graph.json' % test_name):
+    # Some Blink GC plugins dump a JSON or binary representation of the object
+    # graph, and use the processed results as the actual results of the test.
+    graph_file = '%s.graph.json' % test_name
+    if not os.path.exists(graph_file):
+      graph_file = '%s.graph.bin' % test_name
+    if os.path.exists(graph_file):
       try:
-        actual = subprocess.check_output([
-            sys.executable, '../process-graph.py', '-c',
-            '%s.graph.json' % test_name
-        ],
-                                         stderr=subprocess.STDOUT,
-                                         universal_newlines=True)
+        actual = subprocess.check_output(
+            [sys.executable, '../process-graph.py', '-c', graph_file],
+            stderr=subprocess.STDOUT,
+            universal_newlines=True)
       except subprocess.CalledProcessError as e:
         # The graph processing script returns a failure exit code if the graph
         # is bad (e.g. it has a cycle). The output still needs to be captured in
         # that case, since the expected results capture the errors.
         actual = e.output
       finally:
-        # Clean up the .graph.json file to prevent false passes from stale
-        # results from a previous run.
-        os.remove('%s.graph.json' % test_name)
+        # Clean up the graph file to prevent false passes from stale results
+        # from a previous run.
+        os.remove(graph_file)
     return super(BlinkGcPluginTest, self).ProcessOneResult(test_name, actual)
 
 
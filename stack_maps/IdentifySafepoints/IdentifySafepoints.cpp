@@ -2,29 +2,41 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
-#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
-#include "llvm/Pass.h"
-#include "llvm/Support/raw_ostream.h"
-
-#include "llvm/IR/LegacyPassManager.h"
-#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
 
 using namespace llvm;
 
 static int kGCAddressSpace = 1;
 
-bool IsManaged(AllocaInst* AI) {
-  auto* T = AI->getType();
+// Returns the struct types of |M| which look like a Handle. This brittle way of
+// recognising managed on-stack values accepts any single element struct with a
+// GC address-spaced pointer field. Only named structs are considered, as clang
+// gives every class type a name.
+SmallPtrSet<Type*, 8> FindManagedTypes(Module& M) {
+  SmallPtrSet<Type*, 8> ManagedTypes;
+  for (StructType* ST : M.getIdentifiedStructTypes()) {
+    if (ST->getNumElements() == 1 && ST->getElementType(0)->isPointerTy() &&
+        ST->getElementType(0)->getPointerAddressSpace() == kGCAddressSpace)
+      ManagedTypes.insert(ST);
+  }
+  return ManagedTypes;
+}
 
-  // If it looks like a Handle, it probably is a Handle. This brittle way of
-  // checking for managed on-stack values returns true if a single element
-  // struct has a GC address-spaced pointer field.
-  if (T->getElementType()->isStructTy()) {
-    auto* ST = dyn_cast<StructType>(&*T->getElementType());
-    if (ST->getNumElements() == 1 && ST->getElementType(0)->isPointerTy()) {
-      if (ST->getElementType(0)->getPointerAddressSpace() == kGCAddressSpace)
+// Returns true if |F| holds a value of one of |ManagedTypes| on the stack.
+// Clang places the allocas of local variables in the entry block, so no other
+// block needs to be looked at.
+bool HasManagedAlloca(Function& F, const SmallPtrSetImpl<Type*>& ManagedTypes) {
+  for (Instruction& I : F.getEntryBlock()) {
+    if (auto* AI = dyn_cast<AllocaInst>(&I)) {
+      if (ManagedTypes.contains(AI->getAllocatedType()))
         return true;
     }
   }
@@ -32,33 +44,41 @@ bool IsManaged(AllocaInst* AI) {
 }
 
 namespace {
-struct IdentifySafepoints : public FunctionPass {
-  static char ID;
-  IdentifySafepoints() : FunctionPass(ID) {}
+// Marks the functions which hold Handles on the stack with the "statepoint"
+// attribute, for RegisterGcFunctions to select them for statepoint rewriting.
+// This must run before the allocas of Handles are promoted to registers.
+struct IdentifySafepointsPass : public PassInfoMixin<IdentifySafepointsPass> {
+  PreservedAnalyses run(Module& M, ModuleAnalysisManager&) {
+    SmallPtrSet<Type*, 8> ManagedTypes = FindManagedTypes(M);
+    if (ManagedTypes.empty())
+      return PreservedAnalyses::all();
 
-  bool runOnFunction(Function& F) override {
-    for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
-      if (auto* AI = dyn_cast_or_null<AllocaInst>(&*I)) {
-        if (IsManaged(AI)) {
-          F.addFnAttr("statepoint");
-          return false;
-        }
-      }
+    for (Function& F : M) {
+      if (!F.isDeclaration() && HasManagedAlloca(F, ManagedTypes))
+        F.addFnAttr("statepoint");
     }
-    return false;
+    return PreservedAnalyses::all();
   }
 };
-
-char IdentifySafepoints::ID;
 }  // namespace
 
-static RegisterPass<IdentifySafepoints> X("-identify-safepoints",
-                                          "Identify Safepoints",
-                                          false /* Only looks at CFG */,
-                                          true /* Analysis Pass */);
-
-static RegisterStandardPasses Y(PassManagerBuilder::EP_EarlyAsPossible,
-                                [](const PassManagerBuilder& Builder,
-                                   legacy::PassManagerBase& PM) {
-                                  PM.add(new IdentifySafepoints());
-                                });
+// The plugin's entry point. The pass runs at the start of every optimisation
+// pipeline, when clang is given -fpass-plugin=, and can be run by opt as
+// -passes=identify-safepoints.
+extern "C" LLVM_ATTRIBUTE_WEAK PassPluginLibraryInfo llvmGetPassPluginInfo() {
+  return {LLVM_PLUGIN_API_VERSION, "IdentifySafepoints", LLVM_VERSION_STRING,
+          [](PassBuilder& PB) {
+            PB.registerPipelineParsingCallback(
+                [](StringRef Name, ModulePassManager& MPM,
+                   ArrayRef<PassBuilder::PipelineElement>) {
+                  if (Name != "identify-safepoints")
+                    return false;
+                  MPM.addPass(IdentifySafepointsPass());
+                  return true;
+                });
+            PB.registerPipelineStartEPCallback(
+                [](ModulePassManager& MPM, OptimizationLevel) {
+                  MPM.addPass(IdentifySafepointsPass());
+                });
+          }};
+}
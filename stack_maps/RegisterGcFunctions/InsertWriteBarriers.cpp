@@ -0,0 +1,107 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "InsertWriteBarriers.h"
+
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+using namespace llvm;
+
+static unsigned kGCAddressSpace = 1;
+
+// The write barriers are defined in objects.h, which emits them in every
+// module under these names.
+static const char kWriteBarrierName[] = "gc.write_barrier";
+static const char kStackWriteBarrierName[] = "gc.stack_write_barrier";
+
+// Returns true if |SI| stores a managed pointer. Stores of null cannot create a
+// pointer into the nursery, so they need no barrier.
+bool IsManagedPointerStore(StoreInst* SI) {
+  Value* V = SI->getValueOperand();
+  return V->getType()->isPointerTy() &&
+         V->getType()->getPointerAddressSpace() == kGCAddressSpace &&
+         !isa<ConstantPointerNull>(V);
+}
+
+// Returns true if |SI| stores a managed pointer into the heap.
+bool IsHeapStore(StoreInst* SI) {
+  return SI->getPointerAddressSpace() == kGCAddressSpace &&
+         IsManagedPointerStore(SI);
+}
+
+// Returns true if |SI| stores a managed pointer through a pointer which may
+// point into the frame of one of the function's callers, e.g. an out-parameter.
+// A store into one of the function's own allocas, or into a global, cannot.
+bool IsStackStore(StoreInst* SI) {
+  if (SI->getPointerAddressSpace() == kGCAddressSpace ||
+      !IsManagedPointerStore(SI)) {
+    return false;
+  }
+  const Value* Object = getUnderlyingObject(SI->getPointerOperand());
+  return !isa<AllocaInst>(Object) && !isa<GlobalValue>(Object);
+}
+
+// Returns the barrier named |Name|, or null if the module has no definition of
+// it to inline.
+Function* GetBarrier(Module& M, StringRef Name) {
+  Function* Barrier = M.getFunction(Name);
+  if (!Barrier || Barrier->isDeclaration())
+    return nullptr;
+
+  // The barrier never collects, so the calls it makes into the runtime need
+  // no statepoints.
+  for (inst_iterator I = inst_begin(Barrier), E = inst_end(Barrier); I != E;
+       ++I) {
+    if (auto* CB = dyn_cast<CallBase>(&*I))
+      CB->addFnAttr(Attribute::get(M.getContext(), "gc-leaf-function"));
+  }
+  return Barrier;
+}
+
+PreservedAnalyses InsertWriteBarriersPass::run(Module& M,
+                                               ModuleAnalysisManager&) {
+  Function* Barrier = GetBarrier(M, kWriteBarrierName);
+  Function* StackBarrier = GetBarrier(M, kStackWriteBarrierName);
+  if (!Barrier && !StackBarrier)
+    return PreservedAnalyses::all();
+
+  std::vector<std::pair<StoreInst*, Function*>> Stores;
+  for (Function& F : M) {
+    if (&F == Barrier || &F == StackBarrier)
+      continue;
+    for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+      auto* SI = dyn_cast<StoreInst>(&*I);
+      if (!SI)
+        continue;
+      if (Barrier && IsHeapStore(SI))
+        Stores.push_back({SI, Barrier});
+      else if (StackBarrier && IsStackStore(SI))
+        Stores.push_back({SI, StackBarrier});
+    }
+  }
+
+  for (const auto& Store : Stores) {
+    StoreInst* SI = Store.first;
+    FunctionType* FT = Store.second->getFunctionType();
+    IRBuilder<> Builder(SI->getNextNode());
+    Value* Slot =
+        Builder.CreatePointerCast(SI->getPointerOperand(), FT->getParamType(0));
+    Value* V =
+        Builder.CreatePointerCast(SI->getValueOperand(), FT->getParamType(1));
+    CallInst* Call = Builder.CreateCall(Store.second, {Slot, V});
+
+    InlineFunctionInfo IFI;
+    InlineResult Result = InlineFunction(*Call, IFI);
+    assert(Result.isSuccess() && "Could not inline the write barrier");
+    (void)Result;
+  }
+
+  return Stores.empty() ? PreservedAnalyses::all() : PreservedAnalyses::none();
+}
@@ -0,0 +1,20 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLS_CLANG_STACK_MAPS_REGISTERGCFUNCTIONS_INSERTWRITEBARRIERS_H_
+#define TOOLS_CLANG_STACK_MAPS_REGISTERGCFUNCTIONS_INSERTWRITEBARRIERS_H_
+
+#include "llvm/IR/PassManager.h"
+
+// Inlines the write barrier after every store of a managed pointer into the
+// heap, and the stack write barrier after every store of one through a pointer
+// which may point into another frame, in every function of the module. This
+// must run before statepoints are inserted, so that the barriers' values are
+// relocated like any others.
+struct InsertWriteBarriersPass
+    : public llvm::PassInfoMixin<InsertWriteBarriersPass> {
+  llvm::PreservedAnalyses run(llvm::Module& M, llvm::ModuleAnalysisManager&);
+};
+
+#endif  // TOOLS_CLANG_STACK_MAPS_REGISTERGCFUNCTIONS_INSERTWRITEBARRIERS_H_
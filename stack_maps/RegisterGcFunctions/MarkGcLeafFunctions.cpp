@@ -0,0 +1,173 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "MarkGcLeafFunctions.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+using namespace llvm;
+
+static const char kGcLeafAttribute[] = "gc-leaf-function";
+
+// The runtime functions which managed code calls but which never collect: the
+// slow paths of allocation and of the write barriers. Every other function of
+// the runtime is assumed to collect.
+static const char* const kLeafRuntimeFunctions[] = {
+    "GCTryAllocate",
+    "GCRememberSlot",
+    "GCRememberStackSlot",
+};
+
+// The library functions which never call back into the program, and so never
+// collect. Other library functions, such as qsort and bsearch, may be passed a
+// callback which collects.
+static const LibFunc kLeafLibFuncs[] = {
+    LibFunc_memchr,  LibFunc_memcmp,  LibFunc_memcpy,  LibFunc_memmove,
+    LibFunc_memset,  LibFunc_strlen,  LibFunc_strnlen, LibFunc_strcmp,
+    LibFunc_strncmp, LibFunc_strchr,  LibFunc_strrchr, LibFunc_strcpy,
+    LibFunc_strncpy, LibFunc_malloc,  LibFunc_calloc,  LibFunc_realloc,
+    LibFunc_free,    LibFunc_fabs,    LibFunc_sqrt,    LibFunc_floor,
+    LibFunc_ceil,    LibFunc_exp,     LibFunc_log,     LibFunc_pow,
+    LibFunc_sin,     LibFunc_cos,
+};
+
+// Returns true if |Call| passes a function to its callee, which may call it.
+bool PassesFunction(CallBase* Call) {
+  for (Value* Arg : Call->args()) {
+    if (isa<Function>(Arg->stripPointerCasts()))
+      return true;
+    auto* PT = dyn_cast<PointerType>(Arg->getType());
+    if (PT && !PT->isOpaque() && PT->getPointerElementType()->isFunctionTy())
+      return true;
+  }
+  return false;
+}
+
+// Returns true if |Call| is a call to a library function which never collects.
+bool IsLeafLibCall(CallBase* Call, const TargetLibraryInfo& TLI) {
+  LibFunc LF;
+  if (!TLI.getLibFunc(*Call, LF) || !TLI.has(LF))
+    return false;
+  return std::find(std::begin(kLeafLibFuncs), std::end(kLeafLibFuncs), LF) !=
+         std::end(kLeafLibFuncs);
+}
+
+// Returns true if |Call| cannot lead to a collection, given the set of
+// functions already proven to be leaves.
+bool IsLeafCall(CallBase* Call,
+                const SmallPtrSetImpl<Function*>& Leaves,
+                const TargetLibraryInfo& TLI) {
+  if (Call->hasFnAttr(kGcLeafAttribute))
+    return true;
+
+  if (Call->isInlineAsm() || PassesFunction(Call))
+    return false;
+
+  Function* Callee = Call->getCalledFunction();
+  if (!Callee)
+    return false;
+
+  // Statepoint rewriting decides which intrinsics may collect.
+  if (Callee->isIntrinsic())
+    return callsGCLeafFunction(Call, TLI);
+
+  return Leaves.contains(Callee) || IsLeafLibCall(Call, TLI);
+}
+
+// Returns true if every call in the bodies of |SCC| cannot lead to a
+// collection. Calls between the functions of |SCC| are assumed not to, which
+// holds if the whole of |SCC| is a leaf.
+bool IsLeafSCC(ArrayRef<Function*> SCC,
+               SmallPtrSetImpl<Function*>& Leaves,
+               FunctionAnalysisManager& FAM) {
+  // A function whose definition can be replaced at link time may call
+  // anything.
+  for (Function* F : SCC) {
+    if (F->isDeclaration() || F->isInterposable())
+      return false;
+  }
+
+  for (Function* F : SCC)
+    Leaves.insert(F);
+
+  for (Function* F : SCC) {
+    const TargetLibraryInfo& TLI = FAM.getResult<TargetLibraryAnalysis>(*F);
+    for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+      auto* Call = dyn_cast<CallBase>(&*I);
+      if (Call && !IsLeafCall(Call, Leaves, TLI)) {
+        for (Function* G : SCC)
+          Leaves.erase(G);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+PreservedAnalyses MarkGcLeafFunctionsPass::run(Module& M,
+                                               ModuleAnalysisManager& MAM) {
+  FunctionAnalysisManager& FAM =
+      MAM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  CallGraph& CG = MAM.getResult<CallGraphAnalysis>(M);
+
+  SmallPtrSet<Function*, 32> Leaves;
+  for (const char* Name : kLeafRuntimeFunctions) {
+    if (Function* F = M.getFunction(Name))
+      Leaves.insert(F);
+  }
+
+  // Callees are visited before their callers, so a caller is only a leaf if
+  // everything it calls has already been proven to be one. Any call which
+  // cannot be resolved to a function, including indirect calls, may collect.
+  for (scc_iterator<CallGraph*> I = scc_begin(&CG); !I.isAtEnd(); ++I) {
+    SmallVector<Function*, 4> SCC;
+    for (CallGraphNode* Node : *I) {
+      if (Function* F = Node->getFunction())
+        SCC.push_back(F);
+    }
+    if (!SCC.empty() && !Leaves.contains(SCC.front()))
+      IsLeafSCC(SCC, Leaves, FAM);
+  }
+
+  for (Function* F : Leaves)
+    F->addFnAttr(kGcLeafAttribute);
+
+  // Statepoint rewriting takes every call to a library function for a leaf.
+  // The ones which are not are marked as nobuiltin, which hides them from it.
+  // It cannot wrap inline assembly at all, so calls to it are marked as leaves
+  // for it, although they still stop their caller from being proven one. Every
+  // function is visited, as the ones which are not leaves are all given the GC
+  // strategy later.
+  for (Function& F : M) {
+    if (F.isDeclaration())
+      continue;
+    const TargetLibraryInfo& TLI = FAM.getResult<TargetLibraryAnalysis>(F);
+    for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+      auto* Call = dyn_cast<CallBase>(&*I);
+      if (!Call)
+        continue;
+      LibFunc LF;
+      if (Call->isInlineAsm()) {
+        Call->addFnAttr(Attribute::get(F.getContext(), kGcLeafAttribute));
+      } else if (TLI.getLibFunc(*Call, LF) &&
+                 !IsLeafCall(Call, Leaves, TLI)) {
+        Call->addFnAttr(Attribute::NoBuiltin);
+      }
+    }
+  }
+
+  // Only function and call attributes were added, which no analysis depends
+  // on.
+  return PreservedAnalyses::all();
+}
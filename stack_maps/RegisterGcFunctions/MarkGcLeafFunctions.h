@@ -0,0 +1,19 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLS_CLANG_STACK_MAPS_REGISTERGCFUNCTIONS_MARKGCLEAFFUNCTIONS_H_
+#define TOOLS_CLANG_STACK_MAPS_REGISTERGCFUNCTIONS_MARKGCLEAFFUNCTIONS_H_
+
+#include "llvm/IR/PassManager.h"
+
+// Marks the functions which can never reach a collection with the
+// "gc-leaf-function" attribute, so that statepoint rewriting emits plain calls
+// to them. This must run after safepoint polls are placed, as a poll makes its
+// function able to collect.
+struct MarkGcLeafFunctionsPass
+    : public llvm::PassInfoMixin<MarkGcLeafFunctionsPass> {
+  llvm::PreservedAnalyses run(llvm::Module& M, llvm::ModuleAnalysisManager&);
+};
+
+#endif  // TOOLS_CLANG_STACK_MAPS_REGISTERGCFUNCTIONS_MARKGCLEAFFUNCTIONS_H_
@@ -2,17 +2,23 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
-#include "llvm/IR/Function.h"
-#include "llvm/IR/InstIterator.h"
-#include "llvm/IR/Instructions.h"
-#include "llvm/Pass.h"
-#include "llvm/Support/raw_ostream.h"
+#include "InsertWriteBarriers.h"
+#include "MarkGcLeafFunctions.h"
 
-#include "llvm/ADT/DepthFirstIterator.h"
-#include "llvm/Analysis/CallGraph.h"
+#include <memory>
 
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
 #include "llvm/IR/LegacyPassManager.h"
-#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Scalar/RewriteStatepointsForGC.h"
 
 using namespace llvm;
 
@@ -28,11 +34,11 @@ void MaybeStatepointFunction(Function* F) {
 }
 
 namespace {
-struct RegisterGcFunctions : public ModulePass {
-  static char ID;
-  RegisterGcFunctions() : ModulePass(ID) {}
-
-  bool runOnModule(Module& M) override {
+// Gives the functions selected by IdentifySafepoints, and not annotated with
+// NO_STATEPOINT, the GC strategy which statepoint rewriting looks for.
+struct RegisterGcFunctionsPass
+    : public PassInfoMixin<RegisterGcFunctionsPass> {
+  PreservedAnalyses run(Module& M, ModuleAnalysisManager&) {
     auto GA = M.getNamedGlobal("llvm.global.annotations");
     if (GA) {
       auto a = cast<ConstantArray>(GA->getOperand(0));
@@ -53,20 +59,165 @@ struct RegisterGcFunctions : public ModulePass {
       MaybeStatepointFunction(&*F);
     }
 
-    return false;
+    return PreservedAnalyses::all();
   }
 };
 
-char RegisterGcFunctions::ID;
-}  // end of anonymous namespace
+// Inlines the safepoint poll at the entry of each function with a GC strategy
+// and on its loop backedges. LLVM 14 only has a legacy pass manager version of
+// PlaceSafepoints, so this runs it in a legacy function pass manager of its
+// own.
+struct PlaceSafepointPollsPass
+    : public PassInfoMixin<PlaceSafepointPollsPass> {
+  PreservedAnalyses run(Module& M, ModuleAnalysisManager&) {
+    legacy::FunctionPassManager FPM(&M);
+    FPM.add(createPlaceSafepointsPass());
+
+    bool Changed = FPM.doInitialization();
+    for (Function& F : M) {
+      if (!F.isDeclaration())
+        Changed |= FPM.run(F);
+    }
+    Changed |= FPM.doFinalization();
+    return Changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
+  }
+};
 
-static RegisterPass<RegisterGcFunctions> X("register-gc-fns",
-                                           "Register GC Functions",
-                                           false /* Only looks at CFG */,
-                                           true /* Analysis Pass */);
+// Gives every function which may collect, but was not selected for a stack
+// map, the GC strategy too, so that its call sites get stack map records. They
+// hold no roots, but they record the size of the frame and, through the
+// prologue, which callee-saved registers it saved, which the walker needs to
+// step over the frame and to find the roots its callers keep in those
+// registers. Functions annotated with NO_STATEPOINT must never have one, so
+// they keep their frame pointer instead, whatever the file is built with. This
+// must run after the leaves are marked and the safepoint polls are placed.
+struct RecordUnmanagedFramesPass
+    : public PassInfoMixin<RecordUnmanagedFramesPass> {
+  PreservedAnalyses run(Module& M, ModuleAnalysisManager&) {
+    for (Function& F : M) {
+      if (F.isDeclaration() || F.hasGC() ||
+          F.hasFnAttribute("gc-leaf-function")) {
+        continue;
+      }
+      if (F.hasFnAttribute("no-statepoint"))
+        F.addFnAttr("frame-pointer", "all");
+      else
+        F.setGC("statepoint-example");
+    }
+    return PreservedAnalyses::all();
+  }
+};
 
-static RegisterStandardPasses Y(PassManagerBuilder::EP_ModuleOptimizerEarly,
-                                [](const PassManagerBuilder& Builder,
-                                   legacy::PassManagerBase& PM) {
-                                  PM.add(new RegisterGcFunctions());
-                                });
+// The stack walker decodes which callee-saved registers a frame saved from the
+// prologue at the entry of its function, so prologues must not be
+// shrink-wrapped into later blocks. LLVM does so by default on x86-64, so this
+// turns it off for the code generator which runs in the same process, and
+// stops if it was asked for explicitly.
+void DisableShrinkWrapping() {
+  StringMap<cl::Option*>& Options = cl::getRegisteredOptions();
+  auto It = Options.find("enable-shrink-wrap");
+  if (It == Options.end())
+    return;
+  auto* EnableShrinkWrap =
+      static_cast<cl::opt<cl::boolOrDefault>*>(It->second);
+  if (EnableShrinkWrap->getValue() == cl::BOU_TRUE)
+    report_fatal_error("Statepoint GC does not support -enable-shrink-wrap");
+  EnableShrinkWrap->setValue(cl::BOU_FALSE);
+}
+
+// The module flag which marks a module whose statepoints have been inserted.
+const char kStatepointsInsertedFlag[] = "gc-statepoints-inserted";
+
+// Selects the functions with stack maps, inserts write barriers and safepoint
+// polls, and rewrites the calls in those functions to statepoints, except for
+// calls to functions which can never collect. Does nothing to a module which
+// it has already run on, as the ThinLTO backend may be given one.
+struct StatepointGcPass : public PassInfoMixin<StatepointGcPass> {
+  StatepointGcPass() {
+    MPM.addPass(RegisterGcFunctionsPass());
+    MPM.addPass(InsertWriteBarriersPass());
+    MPM.addPass(PlaceSafepointPollsPass());
+    MPM.addPass(MarkGcLeafFunctionsPass());
+    MPM.addPass(RecordUnmanagedFramesPass());
+    MPM.addPass(RewriteStatepointsForGC());
+  }
+
+  PreservedAnalyses run(Module& M, ModuleAnalysisManager& MAM) {
+    DisableShrinkWrapping();
+    if (M.getModuleFlag(kStatepointsInsertedFlag))
+      return PreservedAnalyses::all();
+    MPM.run(M, MAM);
+    M.addModuleFlag(Module::Max, kStatepointsInsertedFlag, 1);
+    return PreservedAnalyses::none();
+  }
+
+  ModulePassManager MPM;
+};
+}  // end of anonymous namespace
+
+// The plugin's entry point. When clang is given -fpass-plugin=, every pass
+// needed to produce an object with stack maps runs at the end of its
+// optimisation pipeline, so that later optimisations never see the
+// statepoints. With LTO, where that is depends on the pipeline:
+//
+// - With -flto=thin at -O1 and above, the pre-link pipeline leaves the module
+//   optimisations to the post-link one, so the statepoints are inserted at the
+//   end of the post-link pipeline, and the linker must load the plugin too,
+//   e.g. with lld's --load-pass-plugin=.
+// - With -flto=thin at -O0, the pre-link pipeline is the -O0 one, which runs
+//   every extension point, so the statepoints are inserted before the module
+//   is written. The post-link pipeline then finds the module flag
+//   StatepointGcPass adds, and leaves the module as it is.
+// - With -flto, the pre-link pipeline is the per-module one, and the full LTO
+//   post-link pipeline has no OptimizerLast extension point, so the
+//   statepoints are inserted before linking. The link time optimisations then
+//   see them, but they only stop calls through them from being inlined, and
+//   the linker needs no plugin.
+//
+// opt can also run the passes one at a time, as -passes=register-gc-fns,
+// insert-write-barriers, place-safepoint-polls, mark-gc-leaf-fns or
+// record-unmanaged-frames, or all of them as -passes=statepoint-gc.
+extern "C" LLVM_ATTRIBUTE_WEAK PassPluginLibraryInfo llvmGetPassPluginInfo() {
+  return {LLVM_PLUGIN_API_VERSION, "RegisterGcFunctions", LLVM_VERSION_STRING,
+          [](PassBuilder& PB) {
+            PB.registerPipelineParsingCallback(
+                [](StringRef Name, ModulePassManager& MPM,
+                   ArrayRef<PassBuilder::PipelineElement>) {
+                  if (Name == "register-gc-fns") {
+                    MPM.addPass(RegisterGcFunctionsPass());
+                  } else if (Name == "insert-write-barriers") {
+                    MPM.addPass(InsertWriteBarriersPass());
+                  } else if (Name == "place-safepoint-polls") {
+                    MPM.addPass(PlaceSafepointPollsPass());
+                  } else if (Name == "mark-gc-leaf-fns") {
+                    MPM.addPass(MarkGcLeafFunctionsPass());
+                  } else if (Name == "record-unmanaged-frames") {
+                    MPM.addPass(RecordUnmanagedFramesPass());
+                  } else if (Name == "statepoint-gc") {
+                    MPM.addPass(StatepointGcPass());
+                  } else {
+                    return false;
+                  }
+                  return true;
+                });
+            // The ThinLTO pre-link pipeline runs the OptimizerLast callbacks
+            // too, and LLVM 14 does not tell them which pipeline they are in.
+            // At -O1 and above, it leaves the module optimisations, the
+            // vectorizer among them, to the post-link pipeline, so a pipeline
+            // which has no VectorizerStart extension point is the pre-link
+            // one. This is the only state shared between the callbacks, and
+            // only lives for the construction of a pipeline.
+            auto HasVectorizer = std::make_shared<bool>(false);
+            PB.registerVectorizerStartEPCallback(
+                [HasVectorizer](FunctionPassManager&, OptimizationLevel) {
+                  *HasVectorizer = true;
+                });
+            PB.registerOptimizerLastEPCallback(
+                [HasVectorizer](ModulePassManager& MPM, OptimizationLevel) {
+                  bool ThinLTOPreLink = !*HasVectorizer;
+                  *HasVectorizer = false;
+                  if (!ThinLTOPreLink)
+                    MPM.addPass(StatepointGcPass());
+                });
+          }};
+}
@@ -0,0 +1,96 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures the cost of looking up a frame's roots in the SafepointTable, as
+// done once per frame by the stack walker, and the table's size per safepoint.
+// A std::map keyed the same way is measured alongside as a baseline.
+//
+// Usage: safepoint_table_benchmark [lookups_per_size]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "safepoint_table.h"
+
+namespace {
+
+constexpr size_t kTableSizes[] = {10000, 100000, 1000000};
+constexpr size_t kDefaultLookups = 10000000;
+
+struct Roots {
+  std::vector<DWARF> reg_roots;
+  std::vector<StackRoot> stack_roots;
+};
+
+// Prevents the compiler from discarding the result of a lookup.
+volatile size_t sink;
+
+template <typename Fn>
+double NanosPerLookup(const std::vector<ReturnAddress>& frames, Fn&& lookup) {
+  size_t total = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (auto ra : frames)
+    total += lookup(ra);
+  auto end = std::chrono::steady_clock::now();
+  sink = total;
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         frames.size();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t num_lookups = argc > 1 ? strtoull(argv[1], nullptr, 10)
+                                : kDefaultLookups;
+  std::mt19937_64 rng(42);
+
+  printf("%12s %16s %16s %16s\n", "safepoints", "map ns/frame",
+         "table ns/frame", "table B/sp");
+  for (size_t size : kTableSizes) {
+    // Return addresses are spread out like call sites in a large binary. Each
+    // safepoint has between one and four on-stack roots, and one in eight
+    // also has a root too far up its frame for the stack slot bitmap.
+    std::map<ReturnAddress, Roots> map;
+    SafepointTable::Builder builder;
+    std::vector<ReturnAddress> addresses;
+    ReturnAddress ra = 0x400000;
+    for (size_t i = 0; i < size; i++) {
+      ra += 8 + rng() % 512;
+      Roots roots;
+      for (size_t j = 0, n = 1 + rng() % 4; j < n; j++)
+        roots.stack_roots.push_back(8 * (j + 1));
+      if (rng() % 8 == 0)
+        roots.stack_roots.push_back(8 * (kNumStackSlots + rng() % 64));
+      builder.Add(ra, roots.reg_roots, roots.stack_roots);
+      map.insert({ra, roots});
+      addresses.push_back(ra);
+    }
+    SafepointTable table = builder.Build();
+
+    // Frames are visited in random order, so that consecutive lookups do not
+    // share cache lines as they would not in a real stack walk.
+    std::vector<ReturnAddress> frames(num_lookups);
+    for (auto& frame : frames)
+      frame = addresses[rng() % addresses.size()];
+
+    double map_ns = NanosPerLookup(frames, [&map](ReturnAddress ra) {
+      auto it = map.find(ra);
+      return it == map.end() ? 0 : it->second.stack_roots.size();
+    });
+    double table_ns = NanosPerLookup(frames, [&table](ReturnAddress ra) {
+      FrameRoots roots = table.Find(ra);
+      return roots.stack_roots().size() +
+             __builtin_popcount(roots.stack_slots());
+    });
+
+    printf("%12zu %16.2f %16.2f %16.2f\n", size, map_ns, table_ns,
+           static_cast<double>(table.memory_usage()) / table.size());
+  }
+  return 0;
+}
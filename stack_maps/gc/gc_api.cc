@@ -4,114 +4,1012 @@
 
 #include "gc_api.h"
 
-SafepointTable spt = GenSafepointTable();
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "stack_map_parser.h"
+
+SafepointIndex safepoint_index;
+SafepointTable spt;
 Heap* heap = nullptr;
 
-HeapAddress Heap::AllocRaw(long value) {
-  assert(heap_ptr < kHeapSize && "Allocation failed: Heap full");
+__thread AllocationBuffer gc_allocation_buffer;
+
+HeapRange gc_heap_range;
+
+__thread StackBarrier gc_stack_barrier;
+
+int gc_safepoint_requested = 0;
+
+namespace {
+
+// The registry of mutator threads. Parking, unparking and the start and end of
+// a collection all happen under |threads_mutex|, and are signalled through
+// |threads_cv|.
+std::mutex threads_mutex;
+std::condition_variable threads_cv;
+std::vector<MutatorThread*> threads;
+size_t num_parked = 0;
+bool collecting = false;
+
+thread_local MutatorThread* current_thread = nullptr;
+
+// The slots the write barrier has recorded on this thread, which are handed to
+// the heap when the thread parks.
+thread_local std::vector<HeapAddress*> remembered_slots;
+
+// The stack slots the stack write barrier has recorded on this thread, which
+// are handed to the thread's MutatorThread when it parks.
+thread_local std::vector<HeapAddress*> remembered_stack_slots;
+
+// The GC workers, which are started by the first collection.
+size_t num_gc_workers = std::max(1u, std::thread::hardware_concurrency());
+std::unique_ptr<GCWorkerPool> gc_workers;
+
+bool gc_stack_barriers = true;
+GCStats gc_stats;
+GCCallback gc_callback = nullptr;
+
+// Registers the thread's allocation buffer with the heap that filled it, and
+// unregisters it when the thread exits.
+class BufferRegistration {
+ public:
+  ~BufferRegistration() {
+    if (heap && heap == heap_)
+      heap->UnregisterBuffer(&gc_allocation_buffer);
+  }
+
+  bool Refill(size_t min_size) {
+    heap_ = heap;
+    return heap->RefillBuffer(&gc_allocation_buffer, min_size);
+  }
+
+ private:
+  Heap* heap_ = nullptr;
+};
+
+thread_local BufferRegistration buffer_registration;
+
+}  // namespace
+
+SafepointTable GenSafepointTable() {
+  auto parser = stackmap::StackmapV3Parser();
+  return parser.Parse();
+}
+
+void LoadSafepoints() {
+  static std::once_flag loaded;
+  std::call_once(loaded, [] {
+    // A binary post-processed by gen_safepoint_index carries a prebuilt
+    // index, in which case there is nothing to parse.
+    if (!safepoint_index.Map("/proc/self/exe", &__LLVM_StackMaps))
+      spt = GenSafepointTable();
+  });
+}
+
+static FrameRoots FindFrameRoots(ReturnAddress ra) {
+  if (safepoint_index.mapped())
+    return safepoint_index.Find(ra);
+  return spt.Find(ra);
+}
 
-  HeapAddress raw_ptr = &fromspace()[heap_ptr];
-  *raw_ptr = value;
-  heap_ptr++;
-  return raw_ptr;
+// Returns the stack pointer of the caller of a frame, just above the frame's
+// return address, given the frame's stack pointer |sp| and frame pointer |fp|
+// at the call site |roots| were found for. Frames of unknown size have a frame
+// pointer, which points just below the return address.
+static uintptr_t* CallerStackPointer(const FrameRoots& roots,
+                                     uintptr_t* sp,
+                                     uintptr_t fp) {
+  if (roots.frame_size() != kUnknownFrameSize)
+    return sp + roots.frame_size();
+  return reinterpret_cast<uintptr_t*>(fp) + 2;
 }
 
-void Heap::MoveObjects() {
-  for (int i = 0; i < kHeapSize; i++) {
-    auto tmp = a_frag_[i];
-    a_frag_[i] = b_frag_[i];
-    b_frag_[i] = tmp;
+Heap::Heap(size_t old_space_size)
+    : old_space_size_((old_space_size + kBlockSize - 1) & ~(kBlockSize - 1)),
+      nursery_size_((old_space_size_ / kNurseryFraction + kBlockSize - 1) &
+                    ~(kBlockSize - 1)) {
+  // Both spaces are a whole number of mark bitmap words long, so that each
+  // block of the old generation has a bitmap word of its own.
+  void* region =
+      mmap(nullptr, nursery_size_ + old_space_size_, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  assert(region != MAP_FAILED && "Could not reserve the heap");
+  region_ = static_cast<char*>(region);
+  nursery_ = region_;
+  old_space_ = nursery_ + nursery_size_;
+  top_ = nursery_;
+  limit_ = nursery_ + nursery_size_;
+  old_top_ = old_space_;
+  mark_bits_.resize((nursery_size_ + old_space_size_) / kBlockSize);
+  forwarding_.resize(old_space_size_ / kBlockSize);
+}
+
+Heap::~Heap() {
+  for (auto* buffer : buffers_)
+    *buffer = AllocationBuffer();
+  munmap(region_, nursery_size_ + old_space_size_);
+}
+
+HeapRange Heap::range() const {
+  return {reinterpret_cast<uintptr_t>(nursery_),
+          reinterpret_cast<uintptr_t>(nursery_ + nursery_size_),
+          reinterpret_cast<uintptr_t>(old_space_ + old_space_size_)};
+}
+
+char* Heap::AllocateChunk(std::atomic<char*>* top,
+                          char* limit,
+                          size_t min_size,
+                          size_t max_size,
+                          size_t* size) {
+  char* chunk = top->load(std::memory_order_relaxed);
+  do {
+    size_t available = limit - chunk;
+    if (min_size > available)
+      return nullptr;
+    *size = std::min(max_size, available);
+  } while (!top->compare_exchange_weak(chunk, chunk + *size,
+                                       std::memory_order_relaxed));
+  return chunk;
+}
+
+bool Heap::RefillBuffer(AllocationBuffer* buffer, size_t min_size) {
+  if (!buffer->limit) {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (std::find(buffers_.begin(), buffers_.end(), buffer) == buffers_.end())
+      buffers_.push_back(buffer);
+  }
+
+  size_t size;
+  char* chunk = AllocateChunk(&top_, limit_, min_size,
+                              std::max(min_size, kBufferSize), &size);
+  if (!chunk) {
+    *buffer = AllocationBuffer();
+    return false;
   }
-  alloc_on_a_ = !alloc_on_a_;
+  buffer->top = chunk;
+  buffer->limit = chunk + size;
+  return true;
 }
 
-HeapAddress Heap::UpdatePointer(HeapAddress ptr) {
-  int offset =
-      reinterpret_cast<char*>(ptr) - reinterpret_cast<char*>(fromspace());
-  auto* new_ptr = reinterpret_cast<char*>(tospace()) + offset;
-  return reinterpret_cast<HeapAddress>(new_ptr);
+void Heap::UnregisterBuffer(AllocationBuffer* buffer) {
+  std::lock_guard<std::mutex> lock(buffers_mutex_);
+  buffers_.erase(std::remove(buffers_.begin(), buffers_.end(), buffer),
+                 buffers_.end());
 }
 
-void FrameRoots::Print() const {
-  printf("\tRegister Roots: NYI\n");
-  if (!stack_roots_.size()) {
-    printf("\tStack Roots: []\n");
-    return;
+void Heap::RememberSlots(const std::vector<HeapAddress*>& slots) {
+  std::lock_guard<std::mutex> lock(remembered_set_mutex_);
+  remembered_set_.insert(remembered_set_.end(), slots.begin(), slots.end());
+}
+
+HeapAddress Heap::Allocate(size_t num_words, size_t num_pointers) {
+  assert(num_pointers <= num_words);
+  size_t size = (num_words + 1) * sizeof(uintptr_t);
+  char* chunk = AllocateChunk(&top_, limit_, size, size, &size);
+  if (!chunk)
+    return nullptr;
+
+  auto* header = reinterpret_cast<uintptr_t*>(chunk);
+  *header = MakeObjectHeader(num_words, num_pointers);
+  auto* payload = reinterpret_cast<HeapAddress>(header + 1);
+  for (size_t i = 0; i < num_pointers; i++)
+    payload[i] = 0;
+  return payload;
+}
+
+char* Heap::Evacuator::AllocateCopy(size_t size) {
+  if (size <= static_cast<size_t>(limit_ - top_)) {
+    char* copy = top_;
+    top_ += size;
+    return copy;
   }
 
-  printf("\tStack Roots: [");
-  for (auto SR : stack_roots_) {
-    printf("RBP - %d, ", SR);
+  char* chunk;
+  if (size > kMaxBufferedObjectSize) {
+    chunk = AllocateChunk(&heap_->copy_top_, heap_->copy_limit_, size, size,
+                          &size);
+  } else {
+    size_t chunk_size;
+    chunk = AllocateChunk(&heap_->copy_top_, heap_->copy_limit_, size,
+                          kCopyBufferSize, &chunk_size);
+    if (chunk) {
+      top_ = chunk + size;
+      limit_ = chunk + chunk_size;
+    }
   }
-  printf("\b\b]\n");
+  assert(chunk && "Old generation exhausted");
+  return chunk;
+}
+
+void Heap::Evacuator::EvacuateRoot(HeapAddress* slot) {
+  if (heap_->marking_ && heap_->InCollectionSet(*slot))
+    roots_.push_back({slot, *slot});
+  *slot = Evacuate(*slot);
 }
 
-void SafepointTable::Print() const {
-  printf("Safepoint Table\n");
-  for (auto const& pair : roots_) {
-    printf("Frame %p\n", reinterpret_cast<void*>(pair.first));
-    pair.second.Print();
+HeapAddress Heap::Evacuator::Evacuate(HeapAddress ptr) {
+  if (!heap_->InCollectionSet(ptr))
+    return ptr;
+
+  if (heap_->marking_) {
+    uintptr_t header = *(reinterpret_cast<uintptr_t*>(ptr) - 1);
+    if (heap_->Mark(ptr) && NumPointers(header))
+      queue_.Push(ptr);
+    return ptr;
+  }
+
+  auto* header_address = reinterpret_cast<uintptr_t*>(ptr) - 1;
+  uintptr_t header = __atomic_load_n(header_address, __ATOMIC_ACQUIRE);
+  if (header & kForwardedTag)
+    return reinterpret_cast<HeapAddress>(header & ~kForwardedTag);
+
+  // Objects are never modified during a collection apart from their headers,
+  // so the payload can be copied before this worker wins the race for it.
+  size_t size = (NumWords(header) + 1) * sizeof(uintptr_t);
+  char* copy_start = AllocateCopy(size);
+  *reinterpret_cast<uintptr_t*>(copy_start) = header;
+  memcpy(copy_start + sizeof(uintptr_t), ptr, size - sizeof(uintptr_t));
+  auto* copy = reinterpret_cast<HeapAddress>(copy_start + sizeof(uintptr_t));
+
+  uintptr_t forwarded = reinterpret_cast<uintptr_t>(copy) | kForwardedTag;
+  if (!__atomic_compare_exchange_n(header_address, &header, forwarded,
+                                   /*weak=*/false, __ATOMIC_ACQ_REL,
+                                   __ATOMIC_ACQUIRE)) {
+    // Another worker copied the object first. Unless the copy came from the
+    // shared space, it is the last one in the copy buffer and can be undone.
+    if (copy_start + size == top_)
+      top_ = copy_start;
+    return reinterpret_cast<HeapAddress>(header & ~kForwardedTag);
   }
+
+  bytes_copied_ += size;
+  if (NumPointers(header))
+    queue_.Push(copy);
+  return copy;
 }
 
-extern "C" void StackWalkAndMoveObjects(FramePtr fp) {
+void Heap::Evacuator::Drain(
+    const std::vector<std::unique_ptr<Evacuator>>& evacuators,
+    std::atomic<size_t>* num_idle) {
   while (true) {
-    // The caller's return address is always 1 machine word above the recorded
-    // RBP value in the current frame
-    auto ra = reinterpret_cast<ReturnAddress>(*(fp + 1));
+    HeapAddress object;
+    bool found = queue_.Pop(&object);
+    for (size_t i = 0; !found && i < evacuators.size(); i++) {
+      if (evacuators[i].get() != this)
+        found = evacuators[i]->queue_.Steal(&object);
+    }
+
+    if (found) {
+      // The copy's pointer fields still refer to the objects' old addresses.
+      // Evacuating them copies their referents in turn, or marks them.
+      uintptr_t header = *(reinterpret_cast<uintptr_t*>(object) - 1);
+      auto* fields = reinterpret_cast<HeapAddress*>(object);
+      for (size_t i = 0; i < NumPointers(header); i++)
+        fields[i] = Evacuate(fields[i]);
+      continue;
+    }
+
+    // Only workers with work left can give other workers more work, so once
+    // every worker is idle the collection is complete.
+    num_idle->fetch_add(1);
+    while (true) {
+      if (num_idle->load() == evacuators.size())
+        return;
+      bool work_available = false;
+      for (const auto& evacuator : evacuators)
+        work_available |= evacuator->queue_.HasSharedWork();
+      if (work_available) {
+        num_idle->fetch_sub(1);
+        break;
+      }
+      std::this_thread::yield();
+    }
+  }
+}
+
+std::vector<std::unique_ptr<Heap::Evacuator>> Heap::RunWorkers(
+    GCWorkerPool* pool,
+    size_t num_root_tasks,
+    const RootTask& root_task) {
+  size_t num_workers = pool ? pool->size() : 1;
+  size_t num_remembered_tasks =
+      (remembered_set_.size() + kRememberedSlotsPerTask - 1) /
+      kRememberedSlotsPerTask;
+
+  std::vector<std::unique_ptr<Evacuator>> evacuators;
+  for (size_t i = 0; i < num_workers; i++)
+    evacuators.push_back(std::make_unique<Evacuator>(this));
+
+  std::atomic<size_t> next_task{0};
+  std::atomic<size_t> num_idle{0};
+  auto work = [&](size_t worker) {
+    Evacuator* evacuator = evacuators[worker].get();
+    size_t task;
+    while ((task = next_task.fetch_add(1)) <
+           num_root_tasks + num_remembered_tasks) {
+      if (task < num_root_tasks) {
+        root_task(task, evacuator);
+        continue;
+      }
+      size_t begin = (task - num_root_tasks) * kRememberedSlotsPerTask;
+      size_t end =
+          std::min(begin + kRememberedSlotsPerTask, remembered_set_.size());
+      for (size_t i = begin; i < end; i++)
+        evacuator->EvacuateRoot(remembered_set_[i]);
+    }
+    evacuator->Drain(evacuators, &num_idle);
+  };
+  if (pool)
+    pool->Run(work);
+  else
+    work(0);
+  return evacuators;
+}
+
+bool Heap::Mark(HeapAddress ptr) {
+  auto* header = reinterpret_cast<uintptr_t*>(ptr) - 1;
+  size_t begin = header - reinterpret_cast<uintptr_t*>(region_);
+  uint64_t bit = uint64_t{1} << (begin % kWordsPerBlock);
+  if (__atomic_fetch_or(&mark_bits_[begin / kWordsPerBlock], bit,
+                        __ATOMIC_RELAXED) &
+      bit) {
+    return false;
+  }
 
-    // Step up into the caller's frame or bail if we're at the top of stack
-    fp = reinterpret_cast<FramePtr>(*fp);
-    if (reinterpret_cast<uintptr_t>(fp) == TopOfStack)
+  // The words after the header are only ever set by the worker which marked
+  // it, but may share bitmap words with other objects.
+  size_t end = begin + NumWords(*header) + 1;
+  for (size_t i = begin + 1; i < end;) {
+    size_t word_end = std::min(end, (i / kWordsPerBlock + 1) * kWordsPerBlock);
+    size_t count = word_end - i;
+    uint64_t bits = (count == kWordsPerBlock ? ~uint64_t{0}
+                                             : (uint64_t{1} << count) - 1)
+                    << (i % kWordsPerBlock);
+    __atomic_fetch_or(&mark_bits_[i / kWordsPerBlock], bits, __ATOMIC_RELAXED);
+    i = word_end;
+  }
+  return true;
+}
+
+HeapAddress Heap::Forward(HeapAddress ptr) const {
+  auto* header = reinterpret_cast<uintptr_t*>(ptr) - 1;
+  size_t index = header - reinterpret_cast<uintptr_t*>(old_space_);
+  size_t block = index / kWordsPerBlock;
+  uint64_t before = mark_bits_[nursery_size_ / kBlockSize + block] &
+                    ((uint64_t{1} << (index % kWordsPerBlock)) - 1);
+  auto* moved = reinterpret_cast<uintptr_t*>(forwarding_[block]) +
+                __builtin_popcountll(before);
+  return reinterpret_cast<HeapAddress>(moved + 1);
+}
+
+template <typename Fn>
+void Heap::ForEachMarkedObject(char* begin, char* end, Fn fn) {
+  auto* words = reinterpret_cast<uintptr_t*>(region_);
+  size_t i = reinterpret_cast<uintptr_t*>(begin) - words;
+  size_t end_index = reinterpret_cast<uintptr_t*>(end) - words;
+  while (i < end_index) {
+    uint64_t bits = mark_bits_[i / kWordsPerBlock] >> (i % kWordsPerBlock);
+    if (!bits) {
+      i = (i / kWordsPerBlock + 1) * kWordsPerBlock;
+      continue;
+    }
+    i += __builtin_ctzll(bits);
+    if (i >= end_index)
       break;
 
-    printf("==== Frame %p ====\n", reinterpret_cast<void*>(ra));
-
-    auto it = spt.roots()->find(ra);
-    if (it != spt.roots()->end()) {
-      auto fr_roots = it->second;
-      for (auto root : *fr_roots.stack_roots()) {
-        auto offset = root / sizeof(uintptr_t);
-        auto stack_address = reinterpret_cast<uintptr_t*>((fp - offset));
-
-        printf("\tRoot: [RBP - %d]\n", root);
-        printf("\tAddress: %p\n", reinterpret_cast<void*>(*stack_address));
-
-        // We know that all HeapObjects are wrappers around a single long
-        // integer, so for debugging purposes we can cast it as such and print
-        // the value to see if it looks correct.
-        printf("\tValue: %ld\n",
-               reinterpret_cast<HeapObject*>(*stack_address)->data);
-
-        // We are in a collection, so we know that the underlying objects will
-        // be moved before we return to the mutator. We update the on-stack
-        // pointers here to point to the object's new location in the heap.
-        HeapAddress new_ptr =
-            heap->UpdatePointer(reinterpret_cast<HeapAddress>(*stack_address));
-        *stack_address = reinterpret_cast<uintptr_t>(new_ptr);
-
-        printf("\tAddress after Relocation: %p\n",
-               reinterpret_cast<void*>(*stack_address));
+    // Every word of a marked object is marked, so the next set bit after it
+    // is the header of the next one. Its size is read before |fn| gets to
+    // overwrite the header.
+    uintptr_t* header = words + i;
+    i += NumWords(*header) + 1;
+    fn(reinterpret_cast<HeapAddress>(header + 1));
+  }
+}
+
+void Heap::MarkCompact(GCWorkerPool* pool,
+                       size_t num_root_tasks,
+                       const RootTask& root_task) {
+  // Marking finds every live object from the roots, so the remembered set is
+  // rebuilt from scratch.
+  remembered_set_.clear();
+
+  std::vector<std::pair<HeapAddress*, HeapAddress>> roots;
+  {
+    GC_TRACE_SCOPE(trace, "Mark");
+    marking_ = true;
+    auto evacuators = RunWorkers(pool, num_root_tasks, root_task);
+    marking_ = false;
+    for (const auto& evacuator : evacuators) {
+      roots.insert(roots.end(), evacuator->roots_.begin(),
+                   evacuator->roots_.end());
+    }
+    GC_TRACE_ARG(trace, "roots", roots.size());
+  }
+
+  GC_TRACE_SCOPE(trace, "Compact");
+  auto start = std::chrono::steady_clock::now();
+
+  // Each block of marked words is moved down past the marked words of the
+  // blocks before it.
+  size_t live_words = 0;
+  size_t first_old_block = nursery_size_ / kBlockSize;
+  for (size_t i = 0; i < forwarding_.size(); i++) {
+    forwarding_[i] = old_space_ + live_words * sizeof(uintptr_t);
+    live_words += __builtin_popcountll(mark_bits_[first_old_block + i]);
+  }
+  char* new_top = old_space_ + live_words * sizeof(uintptr_t);
+  last_fragmentation_ =
+      old_used() ? 1 - static_cast<double>(new_top - old_space_) / old_used()
+                 : 0;
+
+  // Point every field of a live object which refers to the old generation at
+  // the referent's new address, while the objects are still where marking
+  // found them. The fields of old objects which refer to the nursery are
+  // remembered at their new addresses, for the nursery to be evacuated next.
+  auto update_fields = [this](HeapAddress object) {
+    uintptr_t header = *(reinterpret_cast<uintptr_t*>(object) - 1);
+    auto* fields = reinterpret_cast<HeapAddress*>(object);
+    bool old = InOldSpace(object);
+    for (size_t i = 0; i < NumPointers(header); i++) {
+      if (InOldSpace(fields[i])) {
+        fields[i] = Forward(fields[i]);
+      } else if (old && InNursery(fields[i])) {
+        auto* moved = reinterpret_cast<HeapAddress*>(Forward(object));
+        remembered_set_.push_back(moved + i);
       }
     }
+  };
+  ForEachMarkedObject(nursery_, top_.load(std::memory_order_relaxed),
+                      update_fields);
+  ForEachMarkedObject(old_space_, old_top_, update_fields);
+  for (const auto& root : roots) {
+    *root.first = InOldSpace(root.second) ? Forward(root.second) : root.second;
+    if (InNursery(root.second))
+      remembered_set_.push_back(root.first);
   }
-  heap->MoveObjects();
+
+  // Slide the old objects down in address order, so that each one only
+  // overwrites objects which have already moved, or itself.
+  ForEachMarkedObject(old_space_, old_top_, [this](HeapAddress object) {
+    auto* header = reinterpret_cast<uintptr_t*>(object) - 1;
+    size_t size = (NumWords(*header) + 1) * sizeof(uintptr_t);
+    memmove(reinterpret_cast<uintptr_t*>(Forward(object)) - 1, header, size);
+  });
+
+#ifndef NDEBUG
+  memset(new_top, 0xcd, old_top_ - new_top);
+#endif
+  old_top_ = new_top;
+  std::fill(mark_bits_.begin(), mark_bits_.end(), 0);
+
+  last_compact_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+  GC_TRACE_ARG(trace, "live_bytes", new_top - old_space_);
+  GC_TRACE_ARG(trace, "fragmentation_pct",
+               static_cast<uint64_t>(last_fragmentation_ * 100));
 }
 
-Handle<HeapObject> AllocateHeapObject(long data) {
-  HeapAddress ptr = heap->AllocRaw(data);
-  return Handle<HeapObject>::New(reinterpret_cast<HeapObject*>(ptr));
+void Heap::Collect(GCWorkerPool* pool,
+                   size_t num_root_tasks,
+                   const RootTask& root_task) {
+  size_t num_workers = pool ? pool->size() : 1;
+
+  // Every object in the nursery might survive, and each worker might leave a
+  // partly used copy buffer behind. If the old generation cannot take that
+  // much, it is compacted first. The root tasks then run while marking, and
+  // leave the roots which point into the nursery in the remembered set.
+  size_t worst_case_promoted = nursery_used() + num_workers * kCopyBufferSize;
+  collecting_full_ = old_space_size_ - old_used() < worst_case_promoted;
+  if (collecting_full_) {
+    MarkCompact(pool, num_root_tasks, root_task);
+    num_root_tasks = 0;
+  }
+
+  copy_top_.store(old_top_, std::memory_order_relaxed);
+  copy_limit_ = old_space_ + old_space_size_;
+  auto evacuators = RunWorkers(pool, num_root_tasks, root_task);
+
+  // The unused tails of the copy buffers are left as gaps, except for the one
+  // at the end, from which the next collection resumes copying.
+  last_bytes_copied_ = 0;
+  for (const auto& evacuator : evacuators) {
+    last_bytes_copied_ += evacuator->bytes_copied();
+    if (evacuator->limit_ == copy_top_.load(std::memory_order_relaxed))
+      copy_top_.store(evacuator->top_, std::memory_order_relaxed);
+  }
+
+#ifndef NDEBUG
+  // Any pointer the walker failed to update now refers to garbage, rather than
+  // to a stale copy which could mask the bug.
+  memset(nursery_, 0xcd, nursery_size_);
+#endif
+
+  {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    for (auto* buffer : buffers_)
+      *buffer = AllocationBuffer();
+  }
+
+  // Every surviving object has been promoted, so no old object points into
+  // the nursery any more.
+  remembered_set_.clear();
+
+  old_top_ = copy_top_.load(std::memory_order_relaxed);
+  top_.store(nursery_, std::memory_order_relaxed);
+  copy_top_.store(nullptr, std::memory_order_relaxed);
+  copy_limit_ = nullptr;
+  last_collection_was_full_ = collecting_full_;
+  collecting_full_ = false;
+}
+
+void Heap::Collect(const std::vector<HeapAddress*>& roots) {
+  Collect(nullptr, 1, [&roots](size_t, Evacuator* evacuator) {
+    for (auto* root : roots)
+      evacuator->EvacuateRoot(root);
+  });
+}
+
+namespace {
+
+// An interior pointer found during the stack walk. Its offset into the object
+// is taken before the collection moves the object, and reapplied to the base
+// pointer's new value afterwards.
+struct DerivedSlot {
+  HeapAddress* base;
+  uintptr_t* derived;
+  intptr_t offset;
+};
+
+// The roots found on one thread's stack.
+struct StackRoots {
+  std::vector<HeapAddress*> roots;
+  std::vector<DerivedSlot> derived_slots;
+};
+
+// Scans |thread|'s stack up to its stack barrier, or to the top of the stack if
+// |full|, along with the slots above the barrier which the stack write barrier
+// recorded, and returns the number of frames visited.
+size_t ScanStack(const MutatorThread& thread,
+                 bool full,
+                 StackRoots* stack_roots) {
+  size_t num_frames = 0;
+
+  // Where the value of each callee-saved register in the current frame lives.
+  uintptr_t* reg_slots[kNumCalleeSavedRegs];
+  for (int i = 0; i < kNumCalleeSavedRegs; i++)
+    reg_slots[i] = &thread.regs->regs[i];
+
+  // The safepoint shim's frame holds the return address into the frame which
+  // called it, whose stack pointer at the call site is just above.
+  auto ra = reinterpret_cast<ReturnAddress>(thread.fp[1]);
+  uintptr_t* sp = thread.fp + 2;
+  while (true) {
+    if (ra == reinterpret_cast<ReturnAddress>(&GCStackBarrier)) {
+      if (!full)
+        break;
+      ra = thread.stack_barrier->return_address;
+    }
+
+    // Bail if we're at the top of stack
+    if (reinterpret_cast<uintptr_t>(sp) >= thread.top_of_stack)
+      break;
+
+    num_frames++;
+
+    FrameRoots fr_roots = FindFrameRoots(ra);
+
+    // RBP is only meaningful as a base for the frame's roots, or to step over
+    // the frame, if the frame has a frame pointer.
+    auto* fp = reinterpret_cast<char*>(*reg_slots[kRBPIndex]);
+
+    for (auto root : fr_roots.reg_roots()) {
+      auto* reg_address =
+          reinterpret_cast<HeapAddress*>(reg_slots[CalleeSavedIndex(root)]);
+      stack_roots->roots.push_back(reg_address);
+    }
+
+    for (StackSlots slots = fr_roots.stack_slots(); slots;
+         slots &= slots - 1) {
+      auto* stack_address =
+          reinterpret_cast<HeapAddress*>(sp + __builtin_ctz(slots));
+      stack_roots->roots.push_back(stack_address);
+    }
+
+    for (auto root : fr_roots.stack_roots()) {
+      char* base = IsRBPRelative(root) ? fp : reinterpret_cast<char*>(sp);
+      auto* stack_address =
+          reinterpret_cast<HeapAddress*>(base + StackRootOffset(root));
+      stack_roots->roots.push_back(stack_address);
+    }
+
+    auto location_address = [&](RootLocation location) {
+      if (IsRegisterLocation(location))
+        return reg_slots[CalleeSavedIndex(LocationRegister(location))];
+      char* base = IsRBPRelative(location) ? fp : reinterpret_cast<char*>(sp);
+      return reinterpret_cast<uintptr_t*>(base + StackRootOffset(location));
+    };
+    for (auto* root = fr_roots.derived_roots_begin();
+         root != fr_roots.derived_roots_end(); root++) {
+      auto* base_address =
+          reinterpret_cast<HeapAddress*>(location_address(root->base));
+      uintptr_t* derived_address = location_address(root->derived);
+      intptr_t offset =
+          *derived_address - reinterpret_cast<uintptr_t>(*base_address);
+
+      // The base keeps the object alive even if it is not live itself. It may
+      // also be listed as a root in its own right, which is harmless as
+      // evacuating a slot twice leaves it pointing at the same copy.
+      stack_roots->roots.push_back(base_address);
+      stack_roots->derived_slots.push_back(
+          {base_address, derived_address, offset});
+    }
+
+    // Step up into the caller's frame. This frame's prologue saved its
+    // caller's values of these registers, so further up the stack they are
+    // found in its save slots. Frames of unknown size save RBP along with
+    // their frame pointer.
+    uintptr_t* caller_sp =
+        CallerStackPointer(fr_roots, sp, reinterpret_cast<uintptr_t>(fp));
+    CalleeSaves saves = fr_roots.callee_saves();
+    if (fr_roots.frame_size() == kUnknownFrameSize)
+      saves |= 1 << kRBPIndex;
+    for (int i = 0; i < kNumCalleeSavedRegs; i++) {
+      if (saves & (1 << i))
+        reg_slots[i] = caller_sp - CalleeSaveSlot(saves, i);
+    }
+    ra = caller_sp[-1];
+    sp = caller_sp;
+  }
+
+  // The frames above the barrier have not run since the recorded stores, so
+  // the slots the stores went to are still live.
+  auto* barrier_slot =
+      reinterpret_cast<HeapAddress*>(thread.stack_barrier->slot);
+  for (auto* slot : thread.stack_slots) {
+    if (barrier_slot && slot > barrier_slot)
+      stack_roots->roots.push_back(slot);
+  }
+  return num_frames;
+}
+
+void RemoveStackBarrier(StackBarrier* barrier) {
+  if (!barrier->slot)
+    return;
+  *barrier->slot = barrier->return_address;
+  barrier->slot = nullptr;
+}
+
+// Places a barrier above the frame which called the safepoint shim |thread| is
+// parked in, so that only that frame and the ones it calls are scanned by the
+// next minor collection. There is nothing to gain if the frame's caller is the
+// top of the stack, which is never scanned.
+void InstallStackBarrier(const MutatorThread& thread) {
+  uintptr_t* sp = thread.fp + 2;
+  uintptr_t* caller_sp = CallerStackPointer(
+      FindFrameRoots(thread.fp[1]), sp, thread.regs->regs[kRBPIndex]);
+  if (reinterpret_cast<uintptr_t>(sp) >= thread.top_of_stack ||
+      reinterpret_cast<uintptr_t>(caller_sp) >= thread.top_of_stack) {
+    return;
+  }
+
+  StackBarrier* barrier = thread.stack_barrier;
+  barrier->slot = caller_sp - 1;
+  barrier->return_address = *barrier->slot;
+  *barrier->slot = reinterpret_cast<uintptr_t>(&GCStackBarrier);
+}
+
+// Walks the stacks of all threads, which must be parked, and collects. Each
+// thread's stack is a root task of its own, so stacks are scanned in parallel.
+// Afterwards every thread gets a new stack barrier, as every frame's roots now
+// point into the old generation.
+void CollectGarbage() {
+  if (!gc_workers || gc_workers->size() != num_gc_workers)
+    gc_workers = std::make_unique<GCWorkerPool>(num_gc_workers);
+
+  // We are in a collection, so the underlying objects are moved before we
+  // return to the mutator, and the on-stack pointers are updated to point to
+  // the objects' new locations in the heap.
+  GC_TRACE_SCOPE(trace, "Collect");
+  std::atomic<size_t> num_frames{0};
+  std::atomic<size_t> num_roots{0};
+  std::atomic<uint64_t> scan_ns{0};
+  std::vector<StackRoots> thread_roots(threads.size());
+  heap->Collect(gc_workers.get(), threads.size(),
+                [&num_frames, &num_roots, &scan_ns, &thread_roots](
+                    size_t task, Heap::Evacuator* evacuator) {
+                  StackRoots& stack_roots = thread_roots[task];
+                  size_t frames;
+                  auto start = std::chrono::steady_clock::now();
+                  {
+                    GC_TRACE_SCOPE(scan_trace, "ScanStack");
+                    frames = ScanStack(*threads[task], heap->collecting_full(),
+                                       &stack_roots);
+                    GC_TRACE_ARG(scan_trace, "frames", frames);
+                    GC_TRACE_ARG(scan_trace, "roots",
+                                 stack_roots.roots.size());
+                  }
+                  scan_ns += std::chrono::duration_cast<
+                                 std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+                  num_frames += frames;
+                  num_roots += stack_roots.roots.size();
+                  for (auto* root : stack_roots.roots)
+                    evacuator->EvacuateRoot(root);
+                });
+
+  // A full collection only moves the old objects once every stack has been
+  // scanned, so the bases of the derived pointers are not final until now.
+  for (const auto& stack_roots : thread_roots) {
+    for (const auto& slot : stack_roots.derived_slots)
+      *slot.derived = reinterpret_cast<uintptr_t>(*slot.base) + slot.offset;
+  }
+  gc_stats.last_frames_scanned = num_frames;
+  gc_stats.last_scan_ns = scan_ns;
+  GC_TRACE_ARG(trace, "full", heap->last_collection_was_full());
+  GC_TRACE_ARG(trace, "frames", num_frames.load());
+  GC_TRACE_ARG(trace, "roots", num_roots.load());
+  GC_TRACE_ARG(trace, "bytes_copied", heap->last_bytes_copied());
+
+  for (auto* thread : threads) {
+    thread->stack_slots.clear();
+    RemoveStackBarrier(thread->stack_barrier);
+    if (gc_stack_barriers)
+      InstallStackBarrier(*thread);
+  }
+}
+
+void Park(MutatorThread* thread, FramePtr fp, RegisterFile* regs) {
+  assert(thread && "Thread is not attached to the GC");
+  thread->fp = fp;
+  thread->regs = regs;
+  thread->parked = true;
+  num_parked++;
+
+  // Parking is the last chance for a thread to hand over its remembered slots
+  // before a collection.
+  if (!remembered_slots.empty()) {
+    heap->RememberSlots(remembered_slots);
+    remembered_slots.clear();
+  }
+  thread->stack_slots.insert(thread->stack_slots.end(),
+                             remembered_stack_slots.begin(),
+                             remembered_stack_slots.end());
+  remembered_stack_slots.clear();
+  threads_cv.notify_all();
+}
+
+void Unpark(MutatorThread* thread) {
+  thread->parked = false;
+  num_parked--;
+}
+
+void RegisterThread(uintptr_t top_of_stack) {
+  assert(!current_thread && "Thread is already attached to the GC");
+  current_thread = new MutatorThread(top_of_stack, &gc_stack_barrier);
+  gc_stack_barrier.top_of_stack = top_of_stack;
+
+  // A thread must not start allocating in the middle of a collection.
+  std::unique_lock<std::mutex> lock(threads_mutex);
+  threads_cv.wait(lock, [] { return !collecting; });
+  threads.push_back(current_thread);
+}
+
+}  // namespace
+
+extern "C" void StackWalkAndMoveObjects(FramePtr fp, RegisterFile* regs) {
+  // The table is needed to walk the stacks, so it is loaded before stopping
+  // the world rather than during the first pause.
+  LoadSafepoints();
+
+  auto start = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(threads_mutex);
+  Park(current_thread, fp, regs);
+
+  // A collection which is already underway satisfies this request too.
+  if (collecting) {
+    threads_cv.wait(lock, [] { return !collecting; });
+    Unpark(current_thread);
+    return;
+  }
+
+  GC_TRACE_SCOPE(trace, "GC");
+  collecting = true;
+  __atomic_store_n(&gc_safepoint_requested, 1, __ATOMIC_RELAXED);
+  {
+    GC_TRACE_SCOPE(stop_trace, "StopTheWorld");
+    threads_cv.wait(lock, [] { return num_parked == threads.size(); });
+    GC_TRACE_ARG(stop_trace, "threads", threads.size());
+  }
+
+  CollectGarbage();
+
+  uint64_t pause = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  gc_stats.num_collections++;
+  if (heap->last_collection_was_full())
+    gc_stats.num_full_collections++;
+  gc_stats.last_pause_ns = pause;
+  gc_stats.total_pause_ns += pause;
+  gc_stats.last_bytes_copied = heap->last_bytes_copied();
+  if (heap->last_collection_was_full()) {
+    gc_stats.last_fragmentation = heap->last_fragmentation();
+    gc_stats.last_compact_ns = heap->last_compact_ns();
+    gc_stats.total_compact_ns += heap->last_compact_ns();
+  }
+  GC_TRACE_ARG(trace, "pause_ns", pause);
+  if (gc_callback)
+    gc_callback(gc_stats);
+
+  __atomic_store_n(&gc_safepoint_requested, 0, __ATOMIC_RELAXED);
+  collecting = false;
+  Unpark(current_thread);
+  threads_cv.notify_all();
+}
+
+extern "C" void ParkAtSafepoint(FramePtr fp, RegisterFile* regs) {
+  std::unique_lock<std::mutex> lock(threads_mutex);
+  if (!collecting)
+    return;
+  Park(current_thread, fp, regs);
+  threads_cv.wait(lock, [] { return !collecting; });
+  Unpark(current_thread);
+}
+
+extern "C" uintptr_t MoveStackBarrier(uintptr_t* sp, uintptr_t fp) {
+  StackBarrier* barrier = &gc_stack_barrier;
+  uintptr_t return_address = barrier->return_address;
+  uintptr_t* caller_sp =
+      CallerStackPointer(FindFrameRoots(return_address), sp, fp);
+  if (reinterpret_cast<uintptr_t>(caller_sp) >= barrier->top_of_stack) {
+    barrier->slot = nullptr;
+  } else {
+    barrier->slot = caller_sp - 1;
+    barrier->return_address = *barrier->slot;
+    *barrier->slot = reinterpret_cast<uintptr_t>(&GCStackBarrier);
+  }
+  return return_address;
+}
+
+extern "C" void EnterBlockingCall(FramePtr fp, RegisterFile* regs) {
+  std::lock_guard<std::mutex> lock(threads_mutex);
+  Park(current_thread, fp, regs);
+}
+
+extern "C" void LeaveBlockingCall() {
+  std::unique_lock<std::mutex> lock(threads_mutex);
+  threads_cv.wait(lock, [] { return !collecting; });
+  Unpark(current_thread);
+}
+
+// GetTopOfStack reads the stack pointer of its caller's caller, so it must be
+// called directly from the functions which register threads.
+void AttachThread() {
+  RegisterThread(GetTopOfStack());
+}
+
+void DetachThread() {
+  RemoveStackBarrier(&gc_stack_barrier);
+  if (!remembered_slots.empty()) {
+    heap->RememberSlots(remembered_slots);
+    remembered_slots.clear();
+  }
+  remembered_stack_slots.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    threads.erase(std::remove(threads.begin(), threads.end(), current_thread),
+                  threads.end());
+    // A collector may be waiting for this thread to park.
+    threads_cv.notify_all();
+  }
+  delete current_thread;
+  current_thread = nullptr;
+}
+
+extern "C" long* GCTryAllocate(size_t num_words, size_t num_pointers) {
+  // This may also be called directly rather than from TryAllocate.
+  long* ptr = AllocateInBuffer(&gc_allocation_buffer, num_words, num_pointers);
+  if (ptr)
+    return ptr;
+
+  size_t size = (num_words + 1) * sizeof(uintptr_t);
+  if (size > Heap::kMaxBufferedObjectSize)
+    return heap->Allocate(num_words, num_pointers);
+
+  if (!buffer_registration.Refill(size))
+    return nullptr;
+  return AllocateInBuffer(&gc_allocation_buffer, num_words, num_pointers);
+}
+
+extern "C" void GCRememberSlot(Address GC_AS* slot) {
+  auto* heap_slot = (HeapAddress*)slot;
+  // Code which stores into the same slot repeatedly needs it only once.
+  if (remembered_slots.empty() || remembered_slots.back() != heap_slot)
+    remembered_slots.push_back(heap_slot);
+}
+
+extern "C" void GCRememberStackSlot(Address* slot) {
+  auto* stack_slot = reinterpret_cast<HeapAddress*>(slot);
+  if (remembered_stack_slots.empty() ||
+      remembered_stack_slots.back() != stack_slot) {
+    remembered_stack_slots.push_back(stack_slot);
+  }
+}
+
+void InitGC(size_t old_space_size) {
+  heap = new Heap(old_space_size);
+  gc_heap_range = heap->range();
+  RegisterThread(GetTopOfStack());
 }
 
 void InitGC() {
-  InitTopOfStack();
   heap = new Heap();
+  gc_heap_range = heap->range();
+  RegisterThread(GetTopOfStack());
 }
 
 void TeardownGC() {
+#if defined(GC_TRACING)
+  if (const char* path = getenv("GC_TRACE_FILE"))
+    WriteGCTrace(path);
+#endif
+  DetachThread();
+  gc_heap_range = HeapRange();
   delete heap;
+  heap = nullptr;
+}
+
+void SetGCWorkers(size_t num_workers) {
+  assert(num_workers > 0);
+  std::lock_guard<std::mutex> lock(threads_mutex);
+  num_gc_workers = num_workers;
+}
+
+void SetGCStackBarriers(bool enabled) {
+  std::lock_guard<std::mutex> lock(threads_mutex);
+  gc_stack_barriers = enabled;
+}
+
+void SetGCCallback(GCCallback callback) {
+  std::lock_guard<std::mutex> lock(threads_mutex);
+  gc_callback = callback;
+}
+
+bool WriteGCTrace(const char* path) {
+#if defined(GC_TRACING)
+  FILE* out = fopen(path, "w");
+  if (!out)
+    return false;
+  GetTraceBuffer().WriteJSON(out);
+  return fclose(out) == 0;
+#else
+  return false;
+#endif
+}
+
+GCStats GetGCStats() {
+  std::lock_guard<std::mutex> lock(threads_mutex);
+  return gc_stats;
 }
 
 void PrintSafepointTable() {
+  LoadSafepoints();
+  if (safepoint_index.mapped()) {
+    printf("Safepoint Index: %zu safepoints\n", safepoint_index.size());
+    return;
+  }
   spt.Print();
 }
@@ -6,176 +6,474 @@
 #define TOOLS_CLANG_STACK_MAPS_GC_GC_API_H_
 
 #include <assert.h>
-#include <map>
+#include <stddef.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
 #include <vector>
 
+#include "gc_control.h"
+#include "gc_trace.h"
+#include "gc_worker_pool.h"
 #include "objects.h"
+#include "safepoint_index.h"
+#include "safepoint_table.h"
 
-using ReturnAddress = uint64_t;
 using FramePtr = uintptr_t*;
-using RBPOffset = uint32_t;
-using DWARF = uint16_t;
 
 using HeapAddress = long*;
 
-// The place where HeapObjects live. For simplicity, the underlying data in a
-// HeapObject is always a single uintptr_t. The heap layout mocks a simple
-// semi-space collector where objects can be moved between two heap fragments.
+// The place where HeapObjects live. The heap is generational: objects are
+// allocated in a nursery, and the ones which survive a collection are promoted
+// to an old generation. Most collections are minor ones, which only copy the
+// live objects out of the nursery. When the old generation has too little room
+// left to take in the nursery, a full collection compacts it first.
+//
+// The old generation is a single space collected by mark-compact. A full
+// collection marks every object reachable from the roots in a side bitmap,
+// with one bit per word of every live object, without moving anything. It then
+// slides the marked objects of the old generation down to its start, keeping
+// their order, and promotes the nursery into the space freed at the end. Only
+// a few percent of the old generation are needed for the bitmap and the
+// forwarding addresses, rather than the second copy a semispace collector
+// needs.
+//
+// The nursery and the old generation are carved out of a single mmap'd
+// region, with the nursery first. Each object is preceded by a one word
+// header, and HeapAddresses point just past it at the object's payload:
+//
+//        +--------------------+
+//        |  Header            |  num_words << 32 | num_pointers << 1
+//        +--------------------+
+// ptr--> |  Pointer fields    |  num_pointers HeapAddresses (or nullptr)
+//        +--------------------+
+//        |  Data fields       |  num_words - num_pointers untraced words
+//        +--------------------+
+//
+// Once an object has been copied out of the nursery, its header is overwritten
+// with the address of the copy with the low bit set (a forwarding pointer), so
+// that later references to it are updated to the same copy.
+//
+// A minor collection does not scan the old generation. Instead, the write
+// barrier records each slot in an old object which a pointer into the nursery
+// is stored in, and these remembered slots are roots of the next minor
+// collection. As every surviving object is promoted, the remembered set starts
+// out empty again after each collection.
+//
+// Collections are parallel. Each GC worker copies objects into its own buffer
+// in the old generation and keeps the copies whose fields are still to be
+// scanned in a work-stealing queue. Workers racing to copy the same object each
+// make a copy, and the one whose forwarding pointer is installed first by a
+// compare and swap wins, while the others discard theirs. Marking shares out
+// the objects to scan in the same way, and workers race to set the mark bit of
+// an object's header. Compaction runs on the collecting thread.
 //
-// Note that this is a no-op collector: unreachable objects are not reclaimed
-// and allocation will keep filling the heap until its limited memory is
-// exhausted.
+// Threads allocate from their own AllocationBuffers, which are refilled from
+// the nursery by atomically bumping the shared allocation pointer. Since a
+// collection never scans the heap linearly, the unused tails of retired
+// buffers are simply abandoned. Compaction only visits marked objects, so it
+// does not need them to be parseable either.
 class Heap {
  public:
-  // Allocates a HeapObject's underlying data field on the heap and returns a
-  // pointer to it. This allocation will use the heap fragment returned from a
-  // fromspace() call.
-  HeapAddress AllocRaw(long value);
-
-  // Moves all values from fromspace to tospace. fromspace becomes tospace and
-  // vice versa (i.e. future allocations take place on the opposite heap
-  // fragment). Note no objects are dropped in the process.
-  void MoveObjects();
-
-  // For an arbitrary pointer into the heap, this will return a new pointer with
-  // a corresponding offset into the opposite heap fragment. E.g. a pointer to
-  // an address at offset +4 into heap fragment A would return an address at
-  // offset +4 into heap fragment B.
+  static constexpr size_t kDefaultOldSpaceSize = 1 << 20;
+
+  // The nursery is this fraction of the size of the old generation.
+  static constexpr size_t kNurseryFraction = 4;
+
+  // The size of the chunk a thread reserves for its allocation buffer, and the
+  // largest object allocated from one. Larger objects are allocated from the
+  // shared space directly.
+  static constexpr size_t kBufferSize = 32 * 1024;
+  static constexpr size_t kMaxBufferedObjectSize = kBufferSize / 8;
+
+  // The size of the chunks of the old generation a GC worker copies objects
+  // into.
+  static constexpr size_t kCopyBufferSize = 16 * 1024;
+
+  // The number of remembered slots in each root task of a minor collection.
+  static constexpr size_t kRememberedSlotsPerTask = 1024;
+
+  // The state of one GC worker during a collection.
+  class Evacuator {
+   public:
+    explicit Evacuator(Heap* heap) : heap_(heap) {}
+
+    // Updates the root in |slot| to point to the copy of its object. While
+    // marking, the object is only marked, and the slot is updated once the
+    // object has been moved.
+    void EvacuateRoot(HeapAddress* slot);
+
+    size_t bytes_copied() const { return bytes_copied_; }
+
+   private:
+    friend class Heap;
+
+    // Returns the address of the copy of the object at |ptr|, copying it first
+    // if no worker has copied it yet. Pointers to objects which are not being
+    // collected are returned unchanged. While marking, this marks the object
+    // instead and returns |ptr|.
+    HeapAddress Evacuate(HeapAddress ptr);
+
+    // Scans the objects this worker has copied or marked, and steals the
+    // objects of other workers once it has none left, until every worker is
+    // out of work.
+    void Drain(const std::vector<std::unique_ptr<Evacuator>>& evacuators,
+               std::atomic<size_t>* num_idle);
+
+    char* AllocateCopy(size_t size);
+
+    Heap* heap_;
+    char* top_ = nullptr;
+    char* limit_ = nullptr;
+    WorkStealingQueue<HeapAddress> queue_;
+    size_t bytes_copied_ = 0;
+
+    // The root slots found while marking, with the objects they pointed to.
+    std::vector<std::pair<HeapAddress*, HeapAddress>> roots_;
+  };
+
+  // Called for each root task in a collection, with the Evacuator of the
+  // worker it runs on.
+  using RootTask = std::function<void(size_t task, Evacuator* evacuator)>;
+
+  explicit Heap(size_t old_space_size = kDefaultOldSpaceSize);
+  ~Heap();
+
+  Heap(const Heap&) = delete;
+  Heap& operator=(const Heap&) = delete;
+
+  // Allocates an object with |num_words| words of payload, the first
+  // |num_pointers| of which are pointer fields traced by the collector, and
+  // returns the address of its payload. Pointer fields are initialised to
+  // nullptr. Returns nullptr if the nursery is exhausted, in which case the
+  // caller must collect and retry. This allocates from the shared part of the
+  // nursery; most objects are allocated from AllocationBuffers instead.
+  HeapAddress Allocate(size_t num_words, size_t num_pointers);
+
+  // Retires the contents of |buffer| and reserves a new chunk for it of up to
+  // kBufferSize bytes, and at least |min_size| bytes. Returns false, leaving
+  // the buffer empty, if the nursery has less than |min_size| bytes left.
   //
-  // This is used for relocating root pointer values across a collection during
-  // stack walking.
-  HeapAddress UpdatePointer(HeapAddress ptr);
+  // The heap keeps track of every buffer it has filled, so that it can empty
+  // them when it collects. A buffer must be unregistered before it is freed.
+  bool RefillBuffer(AllocationBuffer* buffer, size_t min_size);
+  void UnregisterBuffer(AllocationBuffer* buffer);
 
- private:
-  static constexpr int kHeapSize = 24;
-
-  HeapAddress fromspace() {
-    if (alloc_on_a_) {
-      return a_frag_;
-    } else {
-      return b_frag_;
-    }
+  // Adds slots recorded by the write barrier to the remembered set.
+  void RememberSlots(const std::vector<HeapAddress*>& slots);
+
+  // Collects on the workers of |pool|, or on the calling thread only if it is
+  // null. The roots are found by |num_root_tasks| tasks, which the workers
+  // share out and which must evacuate the roots they find. A minor collection
+  // also evacuates the remembered slots. Afterwards the nursery is empty, and
+  // so is every allocation buffer. No other thread may be allocating or
+  // storing into the heap meanwhile.
+  //
+  // A root is only up to date once Collect returns, as a full collection moves
+  // the objects the roots point to after all of the root tasks have run.
+  //
+  // The copy buffers leave gaps in the old generation, so a parallel
+  // collection needs some headroom: the heap should not be close to full of
+  // live objects.
+  void Collect(GCWorkerPool* pool,
+               size_t num_root_tasks,
+               const RootTask& root_task);
+
+  // Collects on the calling thread, with the roots in |roots|.
+  void Collect(const std::vector<HeapAddress*>& roots);
+
+  bool InNursery(const void* ptr) const {
+    return ptr >= nursery_ && ptr < nursery_ + nursery_size_;
   }
 
-  HeapAddress tospace() {
-    if (alloc_on_a_) {
-      return b_frag_;
-    } else {
-      return a_frag_;
-    }
+  // Returns true if |ptr| points into the old generation.
+  bool InOldSpace(const void* ptr) const {
+    return ptr >= old_space_ && ptr < old_space_ + old_space_size_;
   }
 
-  int heap_ptr = 0;
-  long a_frag_[kHeapSize];
-  long b_frag_[kHeapSize];
-  bool alloc_on_a_ = true;
-};
+  // Returns true if |ptr| points to a live part of the heap.
+  bool Contains(const void* ptr) const {
+    return InNursery(ptr) || InOldSpace(ptr);
+  }
 
-// A FrameRoots object contains all the information needed to precisely identify
-// live roots for a given safepoint. It contains a list of registers which are
-// known to contain roots, and a list of offsets from the stack pointer to known
-// on-stack-roots.
-//
-// Each stackmap entry in .llvm_stackmaps has two parts: a base pointer (not to
-// be confused with EBP), which simply points to an object header; and a derived
-// pointer which specifies an offset (if any) into the object's interior. In the
-// case where only a base object pointer is desired, the derived pointer will be
-// 0.
-//
-// DWARF Register number mapping can be found here:
-// Pg.63
-// https://software.intel.com/sites/default/files/article/402129/mpx-linux64-abi.pdf
-class FrameRoots {
- public:
-  FrameRoots(std::vector<DWARF> reg_roots, std::vector<RBPOffset> stack_roots)
-      : reg_roots_(reg_roots), stack_roots_(stack_roots) {}
+  // The address range the write barrier checks stores against.
+  HeapRange range() const;
 
-  const std::vector<DWARF>* reg_roots() { return &reg_roots_; }
-  const std::vector<RBPOffset>* stack_roots() { return &stack_roots_; }
+  size_t old_space_size() const { return old_space_size_; }
+  size_t nursery_size() const { return nursery_size_; }
 
-  bool empty() { return reg_roots_.empty() && stack_roots_.empty(); }
+  // The bytes allocated in the nursery and in the old generation, including
+  // the gaps left by allocation and copy buffers.
+  size_t nursery_used() const {
+    return top_.load(std::memory_order_relaxed) - nursery_;
+  }
+  size_t old_used() const { return old_top_ - old_space_; }
 
-  void Print() const;
+  // Whether the collection in progress marks and compacts the old generation
+  // too. Only valid during Collect.
+  bool collecting_full() const { return collecting_full_; }
+
+  // Statistics for the most recent collection.
+  bool last_collection_was_full() const { return last_collection_was_full_; }
+  size_t last_bytes_copied() const { return last_bytes_copied_; }
+
+  // Statistics for the most recent full collection: the fraction of the old
+  // generation's used bytes which were dead objects or gaps before it was
+  // compacted, and the time compaction took.
+  double last_fragmentation() const { return last_fragmentation_; }
+  uint64_t last_compact_ns() const { return last_compact_ns_; }
 
  private:
-  std::vector<DWARF> reg_roots_;
-  std::vector<RBPOffset> stack_roots_;
-};
+  static constexpr uintptr_t kForwardedTag = 1;
 
-// A SafepointTable provides a runtime mapping of function return addresses to
-// on-stack and in-register gc root locations. Return addresses are used as a
-// function call site is the only place where safepoints can exist. This map is
-// a convenient format for the collector to use while walking a call stack
-// looking for the rootset.
-class SafepointTable {
- public:
-  SafepointTable(std::map<ReturnAddress, FrameRoots> roots)
-      : roots_(std::move(roots)) {}
+  // The number of heap words covered by each word of the mark bitmap. The
+  // forwarding addresses of the old generation are kept per block of this
+  // many words.
+  static constexpr size_t kWordsPerBlock = 64;
+  static constexpr size_t kBlockSize = kWordsPerBlock * sizeof(uintptr_t);
+
+  static size_t NumWords(uintptr_t header) { return header >> 32; }
+  static size_t NumPointers(uintptr_t header) {
+    return (header & 0xffffffff) >> 1;
+  }
 
-  const std::map<ReturnAddress, FrameRoots>* roots() { return &roots_; }
+  // Reserves between |min_size| and |max_size| bytes by bumping |top|, as much
+  // as is left before |limit|, and stores the size reserved in |size|. Returns
+  // nullptr if less than |min_size| bytes are left.
+  static char* AllocateChunk(std::atomic<char*>* top,
+                             char* limit,
+                             size_t min_size,
+                             size_t max_size,
+                             size_t* size);
 
-  void Print() const;
+  // Returns true if the object at |ptr| is being copied or marked by the
+  // current collection.
+  bool InCollectionSet(const void* ptr) const {
+    return InNursery(ptr) || (marking_ && InOldSpace(ptr));
+  }
 
- private:
-  const std::map<ReturnAddress, FrameRoots> roots_;
+  // Runs the root tasks, and tasks evacuating the remembered set, on the
+  // workers of |pool|. Each worker drains its queue once there are no tasks
+  // left. Returns the workers' Evacuators.
+  std::vector<std::unique_ptr<Evacuator>> RunWorkers(
+      GCWorkerPool* pool,
+      size_t num_root_tasks,
+      const RootTask& root_task);
+
+  // Marks the objects reachable from the roots found by the root tasks, and
+  // slides the marked objects of the old generation down to its start. The
+  // root slots, and the slots of old objects which point into the nursery, are
+  // left in the remembered set for the nursery to be evacuated from.
+  void MarkCompact(GCWorkerPool* pool,
+                   size_t num_root_tasks,
+                   const RootTask& root_task);
+
+  // Sets the mark bits of every word of the object at |ptr|. Returns false if
+  // the object was already marked.
+  bool Mark(HeapAddress ptr);
+
+  // Returns the address the marked old object at |ptr| is moved to.
+  HeapAddress Forward(HeapAddress ptr) const;
+
+  // Calls |fn| with the payload of every marked object in [begin, end), in
+  // address order. |fn| may move the object to a lower address.
+  template <typename Fn>
+  void ForEachMarkedObject(char* begin, char* end, Fn fn);
+
+  size_t old_space_size_;
+  size_t nursery_size_;
+  char* region_;
+  char* nursery_;
+  char* old_space_;
+
+  // Bump pointer allocation within the nursery, shared by all threads.
+  std::atomic<char*> top_;
+  char* limit_;
+
+  // The end of the objects in the old generation. It only moves during
+  // collections.
+  char* old_top_;
+
+  std::mutex buffers_mutex_;
+  std::vector<AllocationBuffer*> buffers_;
+
+  std::mutex remembered_set_mutex_;
+  std::vector<HeapAddress*> remembered_set_;
+
+  // The space GC workers copy objects into during a collection, and the end
+  // of the chunks of it handed out to them so far.
+  bool collecting_full_ = false;
+  std::atomic<char*> copy_top_{nullptr};
+  char* copy_limit_ = nullptr;
+
+  // The mark bitmap of a full collection, with bit i of word j set for the
+  // word kWordsPerBlock * j + i of the region. It is clear between
+  // collections.
+  bool marking_ = false;
+  std::vector<uint64_t> mark_bits_;
+
+  // The address each block of the old generation's marked words is moved to.
+  std::vector<char*> forwarding_;
+
+  bool last_collection_was_full_ = false;
+  size_t last_bytes_copied_ = 0;
+  double last_fragmentation_ = 0;
+  uint64_t last_compact_ns_ = 0;
 };
 
 SafepointTable GenSafepointTable();
 
+// Maps |safepoint_index| if the executable carries one, and otherwise parses
+// .llvm_stackmaps into |spt|. Only the first call does anything, and it is
+// made by the first collection, so programs which never collect do not pay
+// for it. Both are empty until then.
+void LoadSafepoints();
+
+// The safepoint table parsed from .llvm_stackmaps. It is left empty when
+// |safepoint_index| could be mapped instead.
 extern SafepointTable spt;
+extern SafepointIndex safepoint_index;
 extern Heap* heap;
 
-// During stack scanning, the GC must know when it has reached the top of the
-// stack so that it can hand execution back over to the mutator. This global
-// variable serves that purpose - it is initialised in main to be equal to
-// main's RBP value, and checked against each time the gc steps up into the next
-// stack frame. For non-main threads this could be pthread top.
-extern "C" void InitTopOfStack();
-extern uintptr_t TopOfStack;
+// During stack scanning, the GC must know when it has reached the top of each
+// thread's stack so that it can hand execution back over to the mutator. This
+// returns the stack pointer just above the return address in the frame of its
+// caller, which must be InitGC or AttachThread: the RSP value of the function
+// which called them at the call. Each time the gc steps up into the next stack
+// frame, the frame's stack pointer is checked against this value.
+extern "C" uintptr_t GetTopOfStack();
 
 void PrintSafepointTable();
 
-// Walks the execution stack looking for live gc roots. This function should
-// never be called directly. Instead, the void |GC| function should be
-// called. |GC| is an assembly shim which jumps to this function after
-// placing the value of RBP in RDI (First arg slot mandated by Sys V ABI).
+// The mutator's callee-saved registers at the point it called GC, in the order
+// of kCalleeSavedRegs. The GC shim saves them here before walking the stack and
+// reloads them afterwards, so updating a slot updates the register.
+struct RegisterFile {
+  uintptr_t regs[kNumCalleeSavedRegs];
+};
+
+// The trampoline which stack barriers return into. It is never called.
+extern "C" void GCStackBarrier();
+
+// Called by GCStackBarrier with the stack pointer and frame pointer of the
+// frame the barrier returned into. Moves the calling thread's barrier up to
+// that frame's return address, or removes it, and returns the address the
+// trampoline must jump to.
+extern "C" uintptr_t MoveStackBarrier(uintptr_t* sp, uintptr_t fp);
+
+// A thread which runs managed code and is registered with the collector, so
+// that a collection can find and scan its stack. A collection can only start
+// once every registered thread is parked: stopped at a safepoint, in GC, or in
+// a GCBlockingCall. While a thread is parked, |fp| and |regs| are where the
+// walk of its stack starts.
+struct MutatorThread {
+  MutatorThread(uintptr_t top_of_stack, StackBarrier* stack_barrier)
+      : top_of_stack(top_of_stack), stack_barrier(stack_barrier) {}
+
+  uintptr_t top_of_stack;
+  StackBarrier* stack_barrier;
+  FramePtr fp = nullptr;
+  RegisterFile* regs = nullptr;
+  bool parked = false;
+
+  // The slots above the stack barrier which the stack write barrier recorded
+  // since the last collection, handed over when the thread parks.
+  std::vector<HeapAddress*> stack_slots;
+};
+
+// Stops the world and collects. This function should never be called
+// directly. Instead, the void |GC| function should be called. |GC| is an
+// assembly shim which jumps to this function after placing the value of RBP in
+// RDI (First arg slot mandated by Sys V ABI), and the address of the saved
+// callee-saved registers in RSI.
 //
-// Stack walking starts from the address in `fp` (assumed to be RBP's
-// address). The stack is traversed from bottom to top until the frame pointer
-// hits a terminal value (usually main's RBP value).
+// The calling thread parks itself and requests a collection, which the other
+// registered threads join when they next poll for a safepoint. Once all of them
+// are parked, their stacks are walked in parallel looking for live gc roots.
+// If another thread is already collecting, the calling thread just waits for
+// that collection to finish.
 //
-// This works by assuming the calling convention for each frame adheres to the
-// Sys V ABI, where the frame pointer is known to point to the address of last
-// saved frame pointer (and so on), creating a linked list of frames on the
-// stack (shown below).
+// Stack walking starts from the frame of the shim, whose address is in `fp`
+// (the shim's own RBP), and the stack is traversed from bottom to top until the
+// stack pointer reaches a terminal value (that of the function which
+// registered the thread, e.g. main, at its call).
+//
+// Each frame is stepped over by its size. The stack map records the fixed size
+// of every function's frame, so the stack pointer of the caller at the call
+// site is just above the frame's return address, at a known distance from the
+// frame's own stack pointer:
 //
 //        +--------------------+
 //        |  ...               |
+//        +--------------------+ <-- caller's RSP
+//        |  Return Address    |
 //        +--------------------+
-//        |  Saved RBP         |<--+
-//        +--------------------+   |
-//        |                    |   |
-//        | ...                |   |
-//        |                    |   |
-//        +--------------------+   |
-//        |  Return Address    |   |
-//        +--------------------+   |
-// RBP--> |  Saved RBP         |---+
-//        +--------------------+
-//        |                    |
-//        |  Args              |
-//        |                    |
-//        +--------------------+
+//        |  Saved registers   |
+//        |  Spill slots       |  stack_size bytes
+//        |  Outgoing args     |
+//        +--------------------+ <-- RSP at the call site
+//
+// Managed code can therefore be built with -fomit-frame-pointer, which frees
+// RBP up as a general-purpose register. Frames which have no fixed size (those
+// with variable sized objects), and frames of code without stack maps, are
+// stepped over by following their frame pointer instead, so they must keep it.
+// The record-unmanaged-frames pass gives every function built with the plugin
+// which may collect stack map records, even if it holds no roots, so only
+// functions annotated with NO_STATEPOINT and code built without the plugin are
+// left without them. In frames which have a frame pointer, RBP points to the
+// saved RBP just below the return address.
+//
+// Roots may also live in callee-saved registers. While walking, the walker
+// tracks where the value each such register had in the current frame is
+// stored: initially the RegisterFile, and above any frame whose prologue saved
+// the register, that frame's save slot. RBP is tracked the same way, which is
+// how the walker finds the frame pointer of each frame. Frames without stack
+// maps are assumed to save nothing but RBP, so a root must not be kept in a
+// register across a call through code built without the plugin.
 //
-// This therefore requires that the optimisation -fomit-frame-pointer is
-// disabled in order to guarantee that RBP will not be used as a
-// general-purpose register.
-extern "C" void StackWalkAndMoveObjects(FramePtr fp);
-
-// A very simple allocator for a HeapObject. For the purposes of this
-// experiment, a HeapObject's contents is simply a 64 bit integer. The data
-// itself is not important, what is, however, is that it can be accessed through
-// the rootset after the collector moves it.
-Handle<HeapObject> AllocateHeapObject(HeapAddress data);
+// After each collection, a StackBarrier is placed above the frame which called
+// the safepoint shim. A minor collection stops walking at the barrier, so it
+// only scans the frames which have run since the last collection, however deep
+// the stack is. A full collection moves old objects too, so it walks past the
+// barrier to the top of the stack. Either kind also takes as roots the slots
+// above the barrier which the stack write barrier recorded: a Handle whose
+// address is passed down lives in memory rather than in a value the stack map
+// describes, so neither walk would find it.
+//
+// Every root slot found is collected first, and the heap then copies the live
+// objects and updates the slots in a single collection. Derived pointers, which
+// point into the middle of an object, are not roots themselves: their offsets
+// from their base pointers are recorded before the collection and reapplied to
+// the relocated bases after it.
+extern "C" void StackWalkAndMoveObjects(FramePtr fp, RegisterFile* regs);
+
+// Parks the calling thread until the collection that has been requested is
+// over. Like StackWalkAndMoveObjects, this is only called through an assembly
+// shim, |GCSafepoint|, which mutator code calls when its safepoint polls see
+// that a collection has been requested.
+extern "C" void ParkAtSafepoint(FramePtr fp, RegisterFile* regs);
+
+// Called by the |GCBlockingCall| shim around the blocking function. Entering
+// parks the calling thread without waiting, so that collections can proceed
+// while it blocks. Leaving waits for any collection in progress to finish.
+extern "C" void EnterBlockingCall(FramePtr fp, RegisterFile* regs);
+extern "C" void LeaveBlockingCall();
+
+// Registers the calling thread with the collector, which scans its stack up to
+// the frame of the function which called AttachThread. That function must not
+// itself hold roots, and must call DetachThread before it returns.
+void AttachThread();
+void DetachThread();
+
+// Sets up the heap with an old generation of |old_space_size| bytes, and a
+// nursery a quarter of that size, and attaches the calling thread, as
+// AttachThread does. InitGC() uses Heap::kDefaultOldSpaceSize. TeardownGC
+// detaches the calling thread again.
+void InitGC(size_t old_space_size);
+void InitGC();
+void TeardownGC();
 
 #endif  // TOOLS_CLANG_STACK_MAPS_GC_GC_API_H_
@@ -0,0 +1,63 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLS_CLANG_STACK_MAPS_GC_GC_CONTROL_H_
+#define TOOLS_CLANG_STACK_MAPS_GC_GC_CONTROL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Settings and statistics of the collector, for tests and benchmarks.
+
+// Sets the number of GC workers which scan stacks and copy objects in each
+// collection. The default is the number of hardware threads.
+void SetGCWorkers(size_t num_workers);
+
+// Turns stack barriers, which let minor collections skip the frames which have
+// not run since the last collection, on or off. They are on by default, and
+// must be turned off for code which unwinds or longjmps out of managed frames.
+void SetGCStackBarriers(bool enabled);
+
+struct GCStats {
+  // Every collection, including the full ones which also collect the old
+  // generation.
+  size_t num_collections;
+  size_t num_full_collections;
+
+  // The time from a collection being requested to the mutator resuming.
+  uint64_t last_pause_ns;
+  uint64_t total_pause_ns;
+
+  size_t last_bytes_copied;
+
+  // The fraction of the old generation's used bytes which the last full
+  // collection found to be garbage or gaps, and the time it took to compact
+  // the old generation, excluding marking.
+  double last_fragmentation;
+  uint64_t last_compact_ns;
+  uint64_t total_compact_ns;
+
+  // The frames the stack walker visited, and the time it spent walking them,
+  // summed over all threads.
+  size_t last_frames_scanned;
+  uint64_t last_scan_ns;
+};
+
+GCStats GetGCStats();
+
+// Sets a function to be called with the updated stats at the end of every
+// collection, or none if |callback| is null. It is called on the thread which
+// collected, while every other thread is still parked, so it must not touch
+// the heap.
+using GCCallback = void (*)(const GCStats& stats);
+void SetGCCallback(GCCallback callback);
+
+// Writes the trace of recent collections to |path| as Chrome trace-event JSON,
+// which chrome://tracing and Perfetto can load. Tracing is only compiled in
+// when the collector is built with GC_TRACING, in which case TeardownGC also
+// writes the trace to $GC_TRACE_FILE if it is set. Returns false if tracing is
+// not compiled in or the file could not be written.
+bool WriteGCTrace(const char* path);
+
+#endif  // TOOLS_CLANG_STACK_MAPS_GC_GC_CONTROL_H_
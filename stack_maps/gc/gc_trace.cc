@@ -0,0 +1,105 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "gc_trace.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <chrono>
+
+namespace {
+
+// Small thread ids, which trace viewers show more readably than the OS's.
+uint32_t CurrentTraceThreadId() {
+  static std::atomic<uint32_t> next_tid{1};
+  thread_local uint32_t tid = next_tid.fetch_add(1, std::memory_order_relaxed);
+  return tid;
+}
+
+}  // namespace
+
+constexpr size_t TraceBuffer::kCapacity;
+constexpr size_t TraceBuffer::kEventWords;
+
+void TraceBuffer::Record(const TraceEvent& event) {
+  uint64_t index = next_.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = slots_[index % kCapacity];
+  uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+  do {
+    if (sequence & 1)
+      return;
+  } while (!slot.sequence.compare_exchange_weak(
+      sequence, sequence + 1, std::memory_order_relaxed));
+
+  // Readers which see any of the words below also see the odd sequence number.
+  std::atomic_thread_fence(std::memory_order_release);
+  uint64_t words[kEventWords];
+  memcpy(words, &event, sizeof(event));
+  for (size_t i = 0; i < kEventWords; i++)
+    slot.words[i].store(words[i], std::memory_order_relaxed);
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void TraceBuffer::WriteJSON(FILE* out) const {
+  fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  bool first = true;
+  for (const Slot& slot : slots_) {
+    uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence == 0 || sequence & 1)
+      continue;
+    uint64_t words[kEventWords];
+    for (size_t i = 0; i < kEventWords; i++)
+      words[i] = slot.words[i].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+      continue;
+    TraceEvent event;
+    memcpy(&event, words, sizeof(event));
+
+    // Trace timestamps are in microseconds.
+    fprintf(out,
+            "%s\n{\"name\":\"%s\",\"cat\":\"gc\",\"ph\":\"X\",\"pid\":1,"
+            "\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+            first ? "" : ",", event.name, event.tid, event.start_ns / 1000.0,
+            event.duration_ns / 1000.0);
+    for (uint32_t i = 0; i < event.num_args; i++) {
+      fprintf(out, "%s\"%s\":%llu", i ? "," : "", event.args[i].name,
+              static_cast<unsigned long long>(event.args[i].value));
+    }
+    fprintf(out, "}}");
+    first = false;
+  }
+  fprintf(out, "\n]}\n");
+}
+
+TraceBuffer& GetTraceBuffer() {
+  // The buffer is large, so it is allocated on first use rather than in every
+  // binary linking the collector.
+  static TraceBuffer* buffer = new TraceBuffer();
+  return *buffer;
+}
+
+uint64_t TraceNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+TraceScope::TraceScope(const char* name) {
+  memset(&event_, 0, sizeof(event_));
+  event_.name = name;
+  event_.tid = CurrentTraceThreadId();
+  event_.start_ns = TraceNow();
+}
+
+TraceScope::~TraceScope() {
+  event_.duration_ns = TraceNow() - event_.start_ns;
+  GetTraceBuffer().Record(event_);
+}
+
+void TraceScope::AddArg(const char* name, uint64_t value) {
+  assert(event_.num_args < TraceEvent::kMaxArgs && "Too many trace args");
+  event_.args[event_.num_args++] = {name, value};
+}
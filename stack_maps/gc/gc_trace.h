@@ -0,0 +1,110 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLS_CLANG_STACK_MAPS_GC_GC_TRACE_H_
+#define TOOLS_CLANG_STACK_MAPS_GC_GC_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <type_traits>
+
+// Tracing of the collector's phases, which is compiled in when GC_TRACING is
+// defined and compiles away entirely otherwise. Each traced phase is recorded
+// as a complete event, with its start time, duration, thread and a few named
+// counters, in a fixed-size ring buffer which any thread can record into
+// without taking a lock. Once the buffer is full the oldest events are
+// overwritten.
+//
+// The events are written out in the Chrome trace-event JSON format, which
+// chrome://tracing and Perfetto can load, by WriteGCTrace in gc_control.h.
+
+struct TraceArg {
+  const char* name;
+  uint64_t value;
+};
+
+struct TraceEvent {
+  static constexpr size_t kMaxArgs = 4;
+
+  // Names must be string literals, as only the pointers are recorded.
+  const char* name;
+  uint64_t start_ns;
+  uint64_t duration_ns;
+  uint32_t tid;
+  uint32_t num_args;
+  TraceArg args[kMaxArgs];
+};
+
+static_assert(std::is_trivially_copyable<TraceEvent>::value &&
+                  sizeof(TraceEvent) % sizeof(uint64_t) == 0,
+              "TraceEvent must be copyable as a sequence of words");
+
+class TraceBuffer {
+ public:
+  static constexpr size_t kCapacity = 1 << 14;
+
+  // Records |event|, overwriting the oldest event if the buffer is full. The
+  // event is dropped if its slot is still being written by a writer a whole
+  // buffer behind.
+  void Record(const TraceEvent& event);
+
+  // Writes the events in the buffer as a JSON trace. Events which are being
+  // overwritten while this runs are left out.
+  void WriteJSON(FILE* out) const;
+
+ private:
+  static constexpr size_t kEventWords = sizeof(TraceEvent) / sizeof(uint64_t);
+
+  // A slot's sequence number is odd while its event is being written, and
+  // otherwise counts how many events have been written to it, so that readers
+  // can tell when an event changed under them. A writer claims the slot by
+  // making its sequence number odd, so only one writes it at a time. The event
+  // is stored as atomic words, as readers may copy it while it is written.
+  struct Slot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> words[kEventWords];
+  };
+
+  std::atomic<uint64_t> next_{0};
+  Slot slots_[kCapacity];
+};
+
+// The buffer every traced phase is recorded in.
+TraceBuffer& GetTraceBuffer();
+
+// Returns the nanoseconds elapsed on a monotonic clock.
+uint64_t TraceNow();
+
+// Records an event for the lifetime of the scope, with any arguments added
+// before it ends.
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name);
+  ~TraceScope();
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+  void AddArg(const char* name, uint64_t value);
+
+ private:
+  TraceEvent event_;
+};
+
+#if defined(GC_TRACING)
+#define GC_TRACE_SCOPE(scope, name) TraceScope scope(name)
+#define GC_TRACE_ARG(scope, name, value) scope.AddArg(name, value)
+#else
+#define GC_TRACE_SCOPE(scope, name) \
+  do {                              \
+  } while (0)
+#define GC_TRACE_ARG(scope, name, value) \
+  do {                                   \
+  } while (0)
+#endif
+
+#endif  // TOOLS_CLANG_STACK_MAPS_GC_GC_TRACE_H_
@@ -0,0 +1,59 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "gc_worker_pool.h"
+
+GCWorkerPool::GCWorkerPool(size_t num_workers) {
+  for (size_t i = 1; i < num_workers; i++)
+    threads_.emplace_back(&GCWorkerPool::WorkerMain, this, i);
+}
+
+GCWorkerPool::~GCWorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  cv_.notify_all();
+  for (auto& thread : threads_)
+    thread.join();
+}
+
+void GCWorkerPool::Run(const std::function<void(size_t worker)>& task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    num_running_ = threads_.size();
+    generation_++;
+  }
+  cv_.notify_all();
+
+  task(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this] { return num_running_ == 0; });
+  task_ = nullptr;
+}
+
+void GCWorkerPool::WorkerMain(size_t worker) {
+  uint64_t generation = 0;
+  while (true) {
+    const std::function<void(size_t)>* task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [&] {
+        return shutting_down_ || generation_ != generation;
+      });
+      if (shutting_down_)
+        return;
+      generation = generation_;
+      task = task_;
+    }
+
+    (*task)(worker);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--num_running_ == 0)
+      cv_.notify_all();
+  }
+}
@@ -0,0 +1,122 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLS_CLANG_STACK_MAPS_GC_GC_WORKER_POOL_H_
+#define TOOLS_CLANG_STACK_MAPS_GC_GC_WORKER_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads which run the parallel phases of a collection. The
+// threads are started once and sleep between collections.
+class GCWorkerPool {
+ public:
+  explicit GCWorkerPool(size_t num_workers);
+  ~GCWorkerPool();
+
+  GCWorkerPool(const GCWorkerPool&) = delete;
+  GCWorkerPool& operator=(const GCWorkerPool&) = delete;
+
+  size_t size() const { return threads_.size() + 1; }
+
+  // Runs task(worker) for every worker index in [0, size()), the calling thread
+  // being worker 0, and returns once every worker has finished.
+  void Run(const std::function<void(size_t worker)>& task);
+
+ private:
+  void WorkerMain(size_t worker);
+
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  const std::function<void(size_t)>* task_ = nullptr;
+  uint64_t generation_ = 0;
+  size_t num_running_ = 0;
+  bool shutting_down_ = false;
+};
+
+// A queue of work items owned by a single worker, which other workers can steal
+// from when they run out of work of their own.
+//
+// The owner pushes and pops at the back of a private stack without any
+// synchronisation. When the stack grows large and the shared part of the queue
+// is empty, the oldest half of it is moved to the shared part, which other
+// workers steal from the front of under a lock.
+template <typename T>
+class WorkStealingQueue {
+ public:
+  void Push(T item) {
+    local_.push_back(item);
+    if (local_.size() >= kPublishThreshold &&
+        shared_size_.load(std::memory_order_relaxed) == 0) {
+      Publish();
+    }
+  }
+
+  // Pops an item, from the shared part if the private stack is empty.
+  bool Pop(T* item) {
+    if (local_.empty() && !Reclaim())
+      return false;
+    *item = local_.back();
+    local_.pop_back();
+    return true;
+  }
+
+  // Called by other workers.
+  bool Steal(T* item) {
+    if (shared_size_.load(std::memory_order_relaxed) == 0)
+      return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (shared_.empty())
+      return false;
+    *item = shared_.front();
+    shared_.pop_front();
+    shared_size_.store(shared_.size(), std::memory_order_relaxed);
+    return true;
+  }
+
+  bool HasSharedWork() const {
+    return shared_size_.load(std::memory_order_relaxed) != 0;
+  }
+
+ private:
+  static constexpr size_t kPublishThreshold = 64;
+
+  void Publish() {
+    size_t half = local_.size() / 2;
+    std::lock_guard<std::mutex> lock(mutex_);
+    shared_.insert(shared_.end(), local_.begin(), local_.begin() + half);
+    local_.erase(local_.begin(), local_.begin() + half);
+    shared_size_.store(shared_.size(), std::memory_order_relaxed);
+  }
+
+  // Takes back up to half of the shared part, leaving the rest to stealers.
+  bool Reclaim() {
+    if (shared_size_.load(std::memory_order_relaxed) == 0)
+      return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = (shared_.size() + 1) / 2;
+    local_.insert(local_.end(), shared_.end() - count, shared_.end());
+    shared_.erase(shared_.end() - count, shared_.end());
+    shared_size_.store(shared_.size(), std::memory_order_relaxed);
+    return count != 0;
+  }
+
+  std::vector<T> local_;
+
+  std::mutex mutex_;
+  std::deque<T> shared_;
+  std::atomic<size_t> shared_size_{0};
+};
+
+#endif  // TOOLS_CLANG_STACK_MAPS_GC_GC_WORKER_POOL_H_
@@ -0,0 +1,281 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "safepoint_index.h"
+
+#include <elf.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
+
+constexpr char SafepointIndex::kSectionName[];
+
+namespace {
+
+constexpr char kStackmapSection[] = ".llvm_stackmaps";
+
+// The number of displacements tried for a bucket before giving up on a seed
+// and starting over with the next one. The index has as many slots as keys,
+// so the last buckets to be placed look for free slots among very few. With
+// four keys per bucket a bucket of one key is almost always placed within a
+// few hundred tries, but a larger bucket placed late in a large table can
+// exhaust the bound and force a reseed, which costs another full placement.
+constexpr uint32_t kMaxDisplacement = 1 << 20;
+
+size_t AlignTo8(size_t n) {
+  return (n + 7) & ~7;
+}
+
+template <typename T>
+void Append(std::vector<char>* out, const T* data, size_t count) {
+  auto* bytes = reinterpret_cast<const char*>(data);
+  out->insert(out->end(), bytes, bytes + count * sizeof(T));
+}
+
+bool ReadAt(int fd, void* buf, size_t size, off_t offset) {
+  return pread(fd, buf, size, offset) == static_cast<ssize_t>(size);
+}
+
+// Maps |size| bytes of |fd| at |offset|, which need not be page aligned.
+// |*delta| is set to the offset of the bytes in the mapping.
+void* MapRange(int fd,
+               off_t offset,
+               size_t size,
+               size_t page_size,
+               size_t* delta) {
+  off_t map_offset = offset & ~(page_size - 1);
+  *delta = offset - map_offset;
+  return mmap(nullptr, size + *delta, PROT_READ, MAP_PRIVATE, fd, map_offset);
+}
+
+}  // namespace
+
+SafepointIndex::~SafepointIndex() {
+  if (mapping_)
+    munmap(mapping_, mapping_size_);
+}
+
+std::vector<char> SafepointIndex::Build(const SafepointTable& table,
+                                        uint64_t stackmaps_addr,
+                                        uint64_t stackmaps_hash) {
+  std::vector<std::pair<uint64_t, FrameRoots>> entries;
+  entries.reserve(table.size());
+  table.ForEach([&entries](ReturnAddress ra, FrameRoots roots) {
+    entries.push_back({ra, roots});
+  });
+
+  uint32_t n = entries.size();
+  uint32_t num_buckets = std::max<uint32_t>(
+      1, (n + kKeysPerBucket - 1) / kKeysPerBucket);
+
+  uint64_t seed = 0;
+  std::vector<uint32_t> displacements(num_buckets);
+  std::vector<uint32_t> slot_of(n);
+  for (bool placed = false; !placed; seed++) {
+    std::vector<std::vector<uint32_t>> buckets(num_buckets);
+    for (uint32_t i = 0; i < n; i++) {
+      uint32_t b = Reduce(BucketHash(entries[i].first, seed), num_buckets);
+      buckets[b].push_back(i);
+    }
+
+    // Placing the largest buckets first, while most slots are still free,
+    // makes it far more likely that every bucket finds a displacement.
+    std::vector<uint32_t> order(num_buckets);
+    for (uint32_t b = 0; b < num_buckets; b++)
+      order[b] = b;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      return buckets[a].size() > buckets[b].size();
+    });
+
+    std::vector<bool> taken(n);
+    std::vector<uint32_t> slots;
+    placed = true;
+    for (auto b : order) {
+      if (buckets[b].empty())
+        break;
+      bool found = false;
+      for (uint32_t d = 0; d < kMaxDisplacement && !found; d++) {
+        slots.clear();
+        found = true;
+        for (auto i : buckets[b]) {
+          uint32_t slot = Reduce(SlotHash(entries[i].first, seed, d), n);
+          if (taken[slot] ||
+              std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+            found = false;
+            break;
+          }
+          slots.push_back(slot);
+        }
+        if (found)
+          displacements[b] = d;
+      }
+      if (!found) {
+        placed = false;
+        break;
+      }
+      for (size_t j = 0; j < slots.size(); j++) {
+        taken[slots[j]] = true;
+        slot_of[buckets[b][j]] = slots[j];
+      }
+    }
+  }
+  // The loop increments the seed once more after the successful attempt.
+  seed--;
+
+  std::vector<uint64_t> keys(n);
+  std::vector<uint32_t> root_set_indices(n);
+  RootSetBuilder root_sets;
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t slot = slot_of[i];
+    keys[slot] = entries[i].first;
+    root_set_indices[slot] = root_sets.Add(entries[i].second);
+  }
+  std::vector<RootSet> sets = root_sets.TakeSets();
+  std::vector<uint32_t> pool = root_sets.TakePool();
+
+  IndexHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.num_safepoints = n;
+  header.num_buckets = num_buckets;
+  header.num_root_sets = sets.size();
+  header.pool_size = pool.size();
+  header.seed = seed;
+  header.stackmaps_addr = stackmaps_addr;
+  header.stackmaps_hash = stackmaps_hash;
+
+  std::vector<char> out;
+  Append(&out, &header, 1);
+  Append(&out, displacements.data(), displacements.size());
+  out.resize(AlignTo8(out.size()));
+  Append(&out, keys.data(), keys.size());
+  Append(&out, root_set_indices.data(), root_set_indices.size());
+  Append(&out, sets.data(), sets.size());
+  Append(&out, pool.data(), pool.size());
+  return out;
+}
+
+uint64_t SafepointIndex::HashStackmaps(const char* data, size_t size) {
+  uint64_t hash = Mix(size);
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(word));
+    hash = Mix(hash ^ word) + i;
+  }
+  uint64_t tail = 0;
+  memcpy(&tail, data + i, size - i);
+  return Mix(hash ^ tail);
+}
+
+bool SafepointIndex::Map(const char* path, const char* stackmaps) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  // Locate the sections by reading just the ELF and section headers, and the
+  // section name string table.
+  Elf64_Ehdr ehdr;
+  std::vector<Elf64_Shdr> shdrs;
+  std::vector<char> names;
+  const Elf64_Shdr* section = nullptr;
+  const Elf64_Shdr* stackmaps_section = nullptr;
+  if (ReadAt(fd, &ehdr, sizeof(ehdr), 0) &&
+      memcmp(ehdr.e_ident, ELFMAG, SELFMAG) == 0 &&
+      ehdr.e_ident[EI_CLASS] == ELFCLASS64 &&
+      ehdr.e_shentsize == sizeof(Elf64_Shdr) &&
+      ehdr.e_shstrndx < ehdr.e_shnum) {
+    shdrs.resize(ehdr.e_shnum);
+    if (ReadAt(fd, shdrs.data(), shdrs.size() * sizeof(Elf64_Shdr),
+               ehdr.e_shoff)) {
+      const Elf64_Shdr& strtab = shdrs[ehdr.e_shstrndx];
+      names.resize(strtab.sh_size + 1);
+      if (ReadAt(fd, names.data(), strtab.sh_size, strtab.sh_offset)) {
+        for (const auto& shdr : shdrs) {
+          if (shdr.sh_name >= strtab.sh_size)
+            continue;
+          if (strcmp(&names[shdr.sh_name], kSectionName) == 0)
+            section = &shdr;
+          else if (strcmp(&names[shdr.sh_name], kStackmapSection) == 0)
+            stackmaps_section = &shdr;
+        }
+      }
+    }
+  }
+
+  if (!section || section->sh_size < sizeof(IndexHeader) ||
+      !stackmaps_section) {
+    close(fd);
+    return false;
+  }
+
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t delta;
+  void* mapping = MapRange(fd, section->sh_offset, section->sh_size, page_size,
+                           &delta);
+  size_t size = section->sh_size;
+  size_t stackmaps_delta;
+  void* stackmaps_mapping =
+      MapRange(fd, stackmaps_section->sh_offset, stackmaps_section->sh_size,
+               page_size, &stackmaps_delta);
+  close(fd);
+  if (mapping == MAP_FAILED || stackmaps_mapping == MAP_FAILED) {
+    if (mapping != MAP_FAILED)
+      munmap(mapping, size + delta);
+    if (stackmaps_mapping != MAP_FAILED)
+      munmap(stackmaps_mapping, stackmaps_section->sh_size + stackmaps_delta);
+    return false;
+  }
+
+  // The hash of the file's stackmap section tells whether the index was
+  // generated for it, i.e. for this very binary. Its runtime copy cannot be
+  // hashed instead, since dynamic relocations change it in a PIE.
+  uint64_t stackmaps_hash = HashStackmaps(
+      static_cast<const char*>(stackmaps_mapping) + stackmaps_delta,
+      stackmaps_section->sh_size);
+  munmap(stackmaps_mapping, stackmaps_section->sh_size + stackmaps_delta);
+
+  const char* data = static_cast<const char*>(mapping) + delta;
+  auto* header = reinterpret_cast<const IndexHeader*>(data);
+
+  size_t keys_offset =
+      AlignTo8(sizeof(IndexHeader) + header->num_buckets * sizeof(uint32_t));
+  size_t expected_size = keys_offset +
+                         header->num_safepoints * sizeof(uint64_t) +
+                         header->num_safepoints * sizeof(uint32_t) +
+                         header->num_root_sets * sizeof(RootSet) +
+                         header->pool_size * sizeof(uint32_t);
+
+  // The index must have been generated from this binary's stackmap section,
+  // and the section must be aligned for the key array to be read in place.
+  if (reinterpret_cast<uintptr_t>(data) % 8 != 0 ||
+      header->magic != kMagic || header->version != kVersion ||
+      header->stackmaps_hash != stackmaps_hash ||
+      expected_size != size) {
+    munmap(mapping, size + delta);
+    return false;
+  }
+
+  mapping_ = mapping;
+  mapping_size_ = size + delta;
+  load_bias_ = reinterpret_cast<uint64_t>(stackmaps) - header->stackmaps_addr;
+  seed_ = header->seed;
+  num_safepoints_ = header->num_safepoints;
+  num_buckets_ = header->num_buckets;
+  displacements_ =
+      reinterpret_cast<const uint32_t*>(data + sizeof(IndexHeader));
+  keys_ = reinterpret_cast<const uint64_t*>(data + keys_offset);
+  root_set_indices_ =
+      reinterpret_cast<const uint32_t*>(keys_ + num_safepoints_);
+  root_sets_ =
+      reinterpret_cast<const RootSet*>(root_set_indices_ + num_safepoints_);
+  pool_ = reinterpret_cast<const uint32_t*>(root_sets_ + header->num_root_sets);
+  return true;
+}
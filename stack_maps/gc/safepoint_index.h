@@ -0,0 +1,154 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLS_CLANG_STACK_MAPS_GC_SAFEPOINT_INDEX_H_
+#define TOOLS_CLANG_STACK_MAPS_GC_SAFEPOINT_INDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "safepoint_table.h"
+
+// A SafepointIndex is a precomputed, position-independent form of the
+// SafepointTable which is generated offline by the gen_safepoint_index tool and
+// stored in the executable as the non-allocated `.gc_safepoints` section. At
+// runtime it is mmapped straight out of the executable file, so a process using
+// it never parses `.llvm_stackmaps` nor allocates for its safepoints.
+//
+// Return addresses are looked up with a minimal perfect hash built with the
+// hash-and-displace scheme: a key first hashes into a bucket, and the bucket's
+// displacement selects the second hash which places every key of that bucket in
+// a distinct slot. Lookups therefore cost two hashes and one key comparison
+// regardless of the table size.
+//
+// Keys are stored as link-time addresses. The difference between the runtime
+// address of `__LLVM_StackMaps` and its link-time address recorded in the index
+// gives the load bias of a PIE.
+//
+// Safepoints with the same roots share one RootSet, as in the SafepointTable.
+//
+// The section has the following layout, with all fields naturally aligned:
+//
+//    IndexHeader
+//    uint32 : Displacements[NumBuckets]
+//    uint32 : Padding (only if required to align to 8 byte)
+//    uint64 : Keys[NumSafepoints]
+//    uint32 : RootSetIndices[NumSafepoints]
+//    RootSet[NumRootSets] {
+//      uint32 : Offset into the root pool
+//      uint32 : StackSlots
+//      uint8  : NumRegRoots
+//      uint8  : CalleeSaves
+//      uint16 : NumStackRoots
+//      uint16 : NumDerivedRoots
+//      uint16 : FrameSize
+//    }
+//    uint32 : RootPool[PoolSize]
+class SafepointIndex {
+ public:
+  static constexpr char kSectionName[] = ".gc_safepoints";
+
+  SafepointIndex() = default;
+  ~SafepointIndex();
+
+  SafepointIndex(const SafepointIndex&) = delete;
+  SafepointIndex& operator=(const SafepointIndex&) = delete;
+
+  // Serializes |table| into the contents of a `.gc_safepoints` section.
+  // |stackmaps_addr| is the link-time address of the `.llvm_stackmaps` section
+  // the table was parsed from, and |stackmaps_hash| is the HashStackmaps() of
+  // its contents in the file.
+  static std::vector<char> Build(const SafepointTable& table,
+                                 uint64_t stackmaps_addr,
+                                 uint64_t stackmaps_hash);
+
+  // Hashes the contents of a `.llvm_stackmaps` section as stored in the ELF
+  // file, i.e. before any dynamic relocations are applied to it.
+  static uint64_t HashStackmaps(const char* data, size_t size);
+
+  // Maps the `.gc_safepoints` section of the ELF file at |path|. |stackmaps|
+  // is the runtime address of the stackmap section the index must describe.
+  // Returns false, leaving the index unmapped, if the file has no such section
+  // or it was generated for a different stackmap section, as told by the hash
+  // of the file's stackmap section.
+  bool Map(const char* path, const char* stackmaps);
+
+  bool mapped() const { return keys_ != nullptr; }
+
+  size_t size() const { return num_safepoints_; }
+
+  // Returns the roots recorded for the call site returning to |ra|, or an
+  // empty FrameRoots if |ra| is not a safepoint.
+  FrameRoots Find(ReturnAddress ra) const {
+    if (num_safepoints_ == 0)
+      return FrameRoots();
+    uint64_t key = ra - load_bias_;
+    uint32_t bucket = Reduce(BucketHash(key, seed_), num_buckets_);
+    uint32_t slot = Reduce(SlotHash(key, seed_, displacements_[bucket]),
+                           num_safepoints_);
+    if (keys_[slot] != key)
+      return FrameRoots();
+    return root_sets_[root_set_indices_[slot]].Get(pool_);
+  }
+
+ private:
+  static constexpr uint64_t kMagic = 0x3158444950534347;  // "GCSPIDX1"
+  static constexpr uint32_t kVersion = 6;
+
+  // The average number of keys per bucket. Larger buckets make the index
+  // smaller but take longer to place when it is built.
+  static constexpr uint32_t kKeysPerBucket = 4;
+
+  struct IndexHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t num_safepoints;
+    uint32_t num_buckets;
+    uint32_t num_root_sets;
+    uint32_t pool_size;
+    uint32_t padding;
+    uint64_t seed;
+    uint64_t stackmaps_addr;
+    uint64_t stackmaps_hash;
+  };
+
+  static uint64_t Mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+  }
+
+  static uint32_t BucketHash(uint64_t key, uint64_t seed) {
+    return Mix(key ^ seed) >> 32;
+  }
+
+  static uint32_t SlotHash(uint64_t key, uint64_t seed, uint32_t displacement) {
+    return Mix(key + seed + displacement * 0x9e3779b97f4a7c15ULL);
+  }
+
+  // Maps a 32-bit hash uniformly onto [0, n) without a division.
+  static uint32_t Reduce(uint32_t hash, uint32_t n) {
+    return (static_cast<uint64_t>(hash) * n) >> 32;
+  }
+
+  void* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+
+  uint64_t load_bias_ = 0;
+  uint64_t seed_ = 0;
+  uint32_t num_safepoints_ = 0;
+  uint32_t num_buckets_ = 0;
+  const uint32_t* displacements_ = nullptr;
+  const uint64_t* keys_ = nullptr;
+  const uint32_t* root_set_indices_ = nullptr;
+  const RootSet* root_sets_ = nullptr;
+  const uint32_t* pool_ = nullptr;
+};
+
+#endif  // TOOLS_CLANG_STACK_MAPS_GC_SAFEPOINT_INDEX_H_
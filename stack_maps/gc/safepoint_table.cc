@@ -0,0 +1,215 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "safepoint_table.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+static void PrintLocation(RootLocation location) {
+  if (IsRegisterLocation(location)) {
+    printf("[DWARF %d]", LocationRegister(location));
+  } else {
+    printf("[%s + %d]", IsRBPRelative(location) ? "RBP" : "RSP",
+           StackRootOffset(location));
+  }
+}
+
+static void WriteVarint(std::vector<uint8_t>* out, uint64_t value) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+void FrameRoots::Print() const {
+  if (reg_roots().empty()) {
+    printf("\tRegister Roots: []\n");
+  } else {
+    printf("\tRegister Roots: [");
+    for (auto RR : reg_roots()) {
+      printf("DWARF %d, ", RR);
+    }
+    printf("\b\b]\n");
+  }
+
+  if (stack_roots().empty() && stack_slots() == 0) {
+    printf("\tStack Roots: []\n");
+  } else {
+    printf("\tStack Roots: [");
+    for (StackSlots slots = stack_slots(); slots; slots &= slots - 1)
+      printf("RSP + %d, ", 8 * __builtin_ctz(slots));
+    for (auto SR : stack_roots()) {
+      printf("%s + %d, ", IsRBPRelative(SR) ? "RBP" : "RSP",
+             StackRootOffset(SR));
+    }
+    printf("\b\b]\n");
+  }
+
+  for (auto* DR = derived_roots_begin(); DR != derived_roots_end(); DR++) {
+    printf("\tDerived Root: ");
+    PrintLocation(DR->derived);
+    printf(" from base ");
+    PrintLocation(DR->base);
+    printf("\n");
+  }
+
+  if (frame_size() != kUnknownFrameSize)
+    printf("\tFrame Size: %d words\n", frame_size());
+}
+
+uint32_t RootSetBuilder::Add(const FrameRoots& roots) {
+  RootSet set;
+  memset(&set, 0, sizeof(set));
+  set.stack_slots = roots.stack_slots();
+  set.num_reg_roots = roots.reg_roots().size();
+  set.callee_saves = roots.callee_saves();
+  set.num_stack_roots = roots.stack_roots().size();
+  set.num_derived_roots = roots.num_derived_roots();
+  set.frame_size = roots.frame_size();
+
+  // The key is the set's counts followed by its locations, as laid out in the
+  // pool.
+  std::vector<uint32_t> key = {
+      set.stack_slots,
+      static_cast<uint32_t>(set.num_reg_roots) |
+          static_cast<uint32_t>(set.callee_saves) << 8 |
+          static_cast<uint32_t>(set.num_stack_roots) << 16,
+      static_cast<uint32_t>(set.num_derived_roots) |
+          static_cast<uint32_t>(set.frame_size) << 16};
+  key.insert(key.end(), roots.reg_roots().begin(), roots.reg_roots().end());
+  key.insert(key.end(), roots.stack_roots().begin(), roots.stack_roots().end());
+  for (auto* DR = roots.derived_roots_begin(); DR != roots.derived_roots_end();
+       DR++) {
+    key.push_back(DR->base);
+    key.push_back(DR->derived);
+  }
+
+  auto it = ids_.find(key);
+  if (it != ids_.end())
+    return it->second;
+
+  set.offset = pool_.size();
+  pool_.insert(pool_.end(), key.begin() + 3, key.end());
+  uint32_t id = sets_.size();
+  sets_.push_back(set);
+  ids_.emplace(std::move(key), id);
+  return id;
+}
+
+void SafepointTable::Builder::Add(ReturnAddress ra,
+                                  const std::vector<DWARF>& reg_roots,
+                                  const std::vector<StackRoot>& stack_roots,
+                                  const std::vector<DerivedRoot>& derived_roots,
+                                  CalleeSaves callee_saves,
+                                  FrameSize frame_size) {
+  // Lay the roots out as they are in the pool, so that the root set builder
+  // can take a view of them.
+  StackSlots stack_slots = 0;
+  scratch_.assign(reg_roots.begin(), reg_roots.end());
+  for (auto root : stack_roots) {
+    if (FitsStackSlots(root))
+      stack_slots |= 1u << (StackRootOffset(root) / 8);
+    else
+      scratch_.push_back(root);
+  }
+  size_t num_stack_roots = scratch_.size() - reg_roots.size();
+  for (const auto& derived : derived_roots) {
+    scratch_.push_back(derived.base);
+    scratch_.push_back(derived.derived);
+  }
+
+  FrameRoots roots(scratch_.data(), reg_roots.size(), num_stack_roots,
+                   derived_roots.size(), stack_slots, callee_saves,
+                   frame_size);
+  entries_.push_back({ra, root_sets_.Add(roots)});
+}
+
+SafepointTable SafepointTable::Builder::Build() {
+  // Sort by return address, keeping the first entry recorded for a duplicate
+  // address as std::map::insert would.
+  std::stable_sort(
+      entries_.begin(), entries_.end(),
+      [](const Entry& a, const Entry& b) { return a.ra < b.ra; });
+  entries_.erase(
+      std::unique(entries_.begin(), entries_.end(),
+                  [](const Entry& a, const Entry& b) { return a.ra == b.ra; }),
+      entries_.end());
+
+  SafepointTable table;
+  table.num_safepoints_ = entries_.size();
+
+  std::vector<ReturnAddress> heads;
+  std::vector<uint32_t> offsets;
+  for (size_t i = 0; i < entries_.size(); i += kBlockSize) {
+    heads.push_back(entries_[i].ra);
+    offsets.push_back(table.stream_.size());
+    WriteVarint(&table.stream_, entries_[i].root_set);
+    size_t end = std::min(i + kBlockSize, entries_.size());
+    for (size_t j = i + 1; j < end; j++) {
+      WriteVarint(&table.stream_, entries_[j].ra - entries_[j - 1].ra);
+      WriteVarint(&table.stream_, entries_[j].root_set);
+    }
+    WriteVarint(&table.stream_, 0);
+  }
+  table.stream_.shrink_to_fit();
+
+  size_t n = heads.size();
+  table.keys_.resize(n + 1);
+  table.block_offsets_.resize(n + 1);
+
+  // An in-order traversal of the implicit tree visits nodes in sorted order,
+  // so filling it from the sorted blocks yields the Eytzinger layout. The
+  // traversal is iterative to avoid recursion proportional to tree height.
+  std::vector<size_t> stack;
+  size_t next = 0;
+  size_t k = 1;
+  while (k <= n || !stack.empty()) {
+    if (k <= n) {
+      stack.push_back(k);
+      k = 2 * k;
+      continue;
+    }
+    k = stack.back();
+    stack.pop_back();
+    table.keys_[k] = heads[next];
+    table.block_offsets_[k] = offsets[next];
+    next++;
+    k = 2 * k + 1;
+  }
+
+  table.root_sets_ = root_sets_.TakeSets();
+  table.pool_ = root_sets_.TakePool();
+  entries_.clear();
+  root_sets_ = RootSetBuilder();
+  return table;
+}
+
+size_t SafepointTable::memory_usage() const {
+  return keys_.size() * sizeof(ReturnAddress) +
+         block_offsets_.size() * sizeof(uint32_t) + stream_.size() +
+         root_sets_.size() * sizeof(RootSet) + pool_.size() * sizeof(uint32_t);
+}
+
+void SafepointTable::Print() const {
+  printf("Safepoint Table\n");
+
+  std::vector<std::pair<ReturnAddress, FrameRoots>> safepoints;
+  ForEach([&safepoints](ReturnAddress ra, FrameRoots roots) {
+    safepoints.push_back({ra, roots});
+  });
+  std::sort(safepoints.begin(), safepoints.end(),
+            [](const std::pair<ReturnAddress, FrameRoots>& a,
+               const std::pair<ReturnAddress, FrameRoots>& b) {
+              return a.first < b.first;
+            });
+
+  for (const auto& safepoint : safepoints) {
+    printf("Frame %p\n", reinterpret_cast<void*>(safepoint.first));
+    safepoint.second.Print();
+  }
+}
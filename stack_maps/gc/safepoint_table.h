@@ -0,0 +1,420 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLS_CLANG_STACK_MAPS_GC_SAFEPOINT_TABLE_H_
+#define TOOLS_CLANG_STACK_MAPS_GC_SAFEPOINT_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <new>
+#include <utility>
+#include <vector>
+
+using ReturnAddress = uint64_t;
+using DWARF = uint16_t;
+
+constexpr DWARF kDwarfRBP = 6;
+constexpr DWARF kDwarfRSP = 7;
+
+// The location of an on-stack root: the signed offset of its slot from the
+// register the stack map addresses it by. LLVM addresses statepoint spill
+// slots relative to RSP where it can, and relative to RBP otherwise (e.g. in
+// frames with variable sized objects). The low bit, which is always clear in
+// the offset of an 8-byte aligned GC pointer slot, is set for RBP.
+using StackRoot = uint32_t;
+
+inline StackRoot MakeStackRoot(DWARF base_reg, int32_t offset) {
+  return static_cast<uint32_t>(offset) | (base_reg == kDwarfRBP ? 1 : 0);
+}
+
+inline bool IsRBPRelative(StackRoot root) {
+  return root & 1;
+}
+
+inline int32_t StackRootOffset(StackRoot root) {
+  return static_cast<int32_t>(root & ~1u);
+}
+
+// The location of either half of a derived pointer pair, which may be a stack
+// slot or a register. Stack slots use the StackRoot encoding, which leaves bit
+// 1 clear; registers are encoded as their DWARF number shifted past it.
+using RootLocation = uint32_t;
+
+constexpr RootLocation kRegisterLocationTag = 2;
+
+inline RootLocation MakeRegisterLocation(DWARF reg) {
+  return (static_cast<uint32_t>(reg) << 2) | kRegisterLocationTag;
+}
+
+inline bool IsRegisterLocation(RootLocation location) {
+  return location & kRegisterLocationTag;
+}
+
+inline DWARF LocationRegister(RootLocation location) {
+  return location >> 2;
+}
+
+// A pointer into the interior of an object (for instance, a strength reduced
+// pointer walking an array) which is live across a safepoint, along with the
+// location of the base pointer of the object it points into. When the object
+// moves the derived pointer is relocated as base + (derived - old_base).
+struct DerivedRoot {
+  RootLocation base;
+  RootLocation derived;
+};
+
+// The registers which the System V ABI requires a callee to preserve. These
+// are the only registers that can hold a root across a call. RBP only holds
+// roots in code built without frame pointers.
+constexpr DWARF kCalleeSavedRegs[] = {3 /* RBX */,  12 /* R12 */,
+                                      13 /* R13 */, 14 /* R14 */,
+                                      15 /* R15 */, kDwarfRBP};
+constexpr int kNumCalleeSavedRegs = 6;
+constexpr int kRBPIndex = 5;
+
+// Returns the index of |reg| in kCalleeSavedRegs, or -1.
+inline int CalleeSavedIndex(DWARF reg) {
+  for (int i = 0; i < kNumCalleeSavedRegs; i++) {
+    if (kCalleeSavedRegs[i] == reg)
+      return i;
+  }
+  return -1;
+}
+
+// The callee-saved registers a function pushes in its prologue, as a mask
+// with bit i set for kCalleeSavedRegs[i]. LLVM pushes them straight below the
+// return address, from the highest index to the lowest, so the save slot of
+// each register follows from the mask alone. A function with a frame pointer
+// pushes RBP first and points RBP at its save slot.
+using CalleeSaves = uint8_t;
+
+// Returns the offset, in words below its caller's stack pointer, at which a
+// function with |saves| stores the register kCalleeSavedRegs[index].
+inline int CalleeSaveSlot(CalleeSaves saves, int index) {
+  return 2 + __builtin_popcount(saves >> (index + 1));
+}
+
+// The size of a function's frame in words, from its stack pointer at its call
+// sites up to its caller's stack pointer, return address included. Frames with
+// variable sized objects have no fixed size, and are stepped over by their
+// frame pointer instead.
+using FrameSize = uint16_t;
+
+constexpr FrameSize kUnknownFrameSize = 0;
+
+// The RSP-relative stack slots holding roots, as a bitmap with bit i set for
+// the slot at [RSP + 8 * i]. Frames mostly keep their roots in the first few
+// slots above the stack pointer, so this is how the common case is stored;
+// roots in other stack slots are listed individually.
+using StackSlots = uint32_t;
+
+constexpr int kNumStackSlots = 32;
+
+// Returns true if |root| can be recorded in a StackSlots bitmap.
+inline bool FitsStackSlots(StackRoot root) {
+  int32_t offset = StackRootOffset(root);
+  return !IsRBPRelative(root) && offset >= 0 && offset % 8 == 0 &&
+         offset < 8 * kNumStackSlots;
+}
+
+// A read-only view over a contiguous run of root locations. Root locations of
+// every kind are widened to 32 bits so that they can share a single pool.
+class RootSpan {
+ public:
+  RootSpan() : begin_(nullptr), size_(0) {}
+  RootSpan(const uint32_t* begin, size_t size) : begin_(begin), size_(size) {}
+
+  const uint32_t* begin() const { return begin_; }
+  const uint32_t* end() const { return begin_ + size_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+ private:
+  const uint32_t* begin_;
+  size_t size_;
+};
+
+// A FrameRoots object contains all the information needed to precisely identify
+// live roots for a given safepoint. It contains a list of registers which are
+// known to contain roots, and a list of offsets from the stack or frame pointer
+// to known on-stack-roots.
+//
+// Each stackmap entry in .llvm_stackmaps has two parts: a base pointer (not to
+// be confused with EBP), which simply points to an object header; and a derived
+// pointer which specifies an offset (if any) into the object's interior. In the
+// case where only a base object pointer is desired, the derived pointer will be
+// 0.
+//
+// FrameRoots does not own its data: it is a view into the root pool of the
+// SafepointTable it was looked up in, so it is cheap to copy and must not
+// outlive the table. Stack roots are split between a StackSlots bitmap and a
+// list of the locations which do not fit in it.
+//
+// DWARF Register number mapping can be found here:
+// Pg.63
+// https://software.intel.com/sites/default/files/article/402129/mpx-linux64-abi.pdf
+class FrameRoots {
+ public:
+  FrameRoots() = default;
+  FrameRoots(const uint32_t* roots,
+             uint8_t num_reg_roots,
+             uint16_t num_stack_roots,
+             uint16_t num_derived_roots,
+             StackSlots stack_slots,
+             CalleeSaves callee_saves,
+             FrameSize frame_size)
+      : roots_(roots),
+        stack_slots_(stack_slots),
+        num_reg_roots_(num_reg_roots),
+        num_stack_roots_(num_stack_roots),
+        num_derived_roots_(num_derived_roots),
+        callee_saves_(callee_saves),
+        frame_size_(frame_size) {}
+
+  // DWARF register numbers of registers holding roots.
+  RootSpan reg_roots() const { return RootSpan(roots_, num_reg_roots_); }
+
+  // RSP-relative stack slots holding roots, in the first kNumStackSlots words
+  // above the stack pointer.
+  StackSlots stack_slots() const { return stack_slots_; }
+
+  // Locations of the other stack slots holding roots.
+  RootSpan stack_roots() const {
+    return RootSpan(roots_ + num_reg_roots_, num_stack_roots_);
+  }
+
+  // Interior pointers and the locations of their bases. The bases are not
+  // included in reg_roots() or stack_roots() unless they are live themselves.
+  const DerivedRoot* derived_roots_begin() const {
+    return reinterpret_cast<const DerivedRoot*>(roots_ + num_reg_roots_ +
+                                                num_stack_roots_);
+  }
+  const DerivedRoot* derived_roots_end() const {
+    return derived_roots_begin() + num_derived_roots_;
+  }
+  size_t num_derived_roots() const { return num_derived_roots_; }
+
+  CalleeSaves callee_saves() const { return callee_saves_; }
+
+  FrameSize frame_size() const { return frame_size_; }
+
+  bool empty() const {
+    return num_reg_roots_ == 0 && num_stack_roots_ == 0 &&
+           num_derived_roots_ == 0 && stack_slots_ == 0;
+  }
+
+  void Print() const;
+
+ private:
+  const uint32_t* roots_ = nullptr;
+  StackSlots stack_slots_ = 0;
+  uint8_t num_reg_roots_ = 0;
+  uint16_t num_stack_roots_ = 0;
+  uint16_t num_derived_roots_ = 0;
+  CalleeSaves callee_saves_ = 0;
+  FrameSize frame_size_ = kUnknownFrameSize;
+};
+
+// The roots of a safepoint, shared by every safepoint which has exactly the
+// same roots and frame size. The call sites of a function mostly have one of a
+// few root sets, so each distinct set is stored once. Its register roots,
+// listed stack roots and derived root pairs are packed back-to-back at
+// |offset| in a pool of root locations.
+struct RootSet {
+  uint32_t offset;
+  StackSlots stack_slots;
+  uint8_t num_reg_roots;
+  CalleeSaves callee_saves;
+  uint16_t num_stack_roots;
+  uint16_t num_derived_roots;
+  FrameSize frame_size;
+
+  FrameRoots Get(const uint32_t* pool) const {
+    return FrameRoots(pool + offset, num_reg_roots, num_stack_roots,
+                      num_derived_roots, stack_slots, callee_saves, frame_size);
+  }
+};
+
+// Deduplicates the root sets of a table's safepoints.
+class RootSetBuilder {
+ public:
+  // Returns the index of the set holding exactly |roots|, adding it if it is
+  // new.
+  uint32_t Add(const FrameRoots& roots);
+
+  size_t size() const { return sets_.size(); }
+
+  std::vector<RootSet> TakeSets() { return std::move(sets_); }
+  std::vector<uint32_t> TakePool() { return std::move(pool_); }
+
+ private:
+  std::map<std::vector<uint32_t>, uint32_t> ids_;
+  std::vector<RootSet> sets_;
+  std::vector<uint32_t> pool_;
+};
+
+// A SafepointTable provides a runtime mapping of function return addresses to
+// on-stack and in-register gc root locations. Return addresses are used as a
+// function call site is the only place where safepoints can exist. This map is
+// a convenient format for the collector to use while walking a call stack
+// looking for the rootset.
+//
+// The safepoints are sorted by return address and split into blocks of
+// kBlockSize. Each block is encoded in a byte stream as LEB128 varints: the
+// index of the first safepoint's root set, then for each following safepoint
+// the delta from the previous return address and its root set index, and
+// finally a zero delta. Call sites are close together, so most safepoints
+// take two or three bytes.
+//
+// The return address each block starts at is kept in an array laid out in
+// Eytzinger (BFS) order, so that a search touches one cache line per few levels
+// and can prefetch ahead, alongside a parallel array of the blocks' offsets in
+// the stream. A lookup finds the last block starting at or before the return
+// address, and decodes it up to the address.
+class SafepointTable {
+ public:
+  // Accumulates safepoints in any order and packs them into a table.
+  class Builder {
+   public:
+    void Add(ReturnAddress ra,
+             const std::vector<DWARF>& reg_roots,
+             const std::vector<StackRoot>& stack_roots,
+             const std::vector<DerivedRoot>& derived_roots = {},
+             CalleeSaves callee_saves = 0,
+             FrameSize frame_size = kUnknownFrameSize);
+
+    SafepointTable Build();
+
+   private:
+    struct Entry {
+      ReturnAddress ra;
+      uint32_t root_set;
+    };
+
+    std::vector<Entry> entries_;
+    RootSetBuilder root_sets_;
+    std::vector<uint32_t> scratch_;
+  };
+
+  SafepointTable() : keys_(1, 0), block_offsets_(1) {}
+
+  // Returns the roots recorded for the call site returning to |ra|, or an
+  // empty FrameRoots with no callee saves if |ra| is not a safepoint.
+  FrameRoots Find(ReturnAddress ra) const {
+    const ReturnAddress* keys = keys_.data();
+    size_t n = keys_.size() - 1;
+    size_t k = 1;
+    while (k <= n) {
+      // The descendants of k four levels down are contiguous, so prefetching
+      // them hides most of the latency of the deep levels of large tables.
+      // They fill two cache lines, since the keys are cache line aligned, and
+      // the search goes on through either. Prefetches past the end of the
+      // array are harmless.
+      uintptr_t descendants = reinterpret_cast<uintptr_t>(keys) +
+                              k * kPrefetchStride * sizeof(ReturnAddress);
+      __builtin_prefetch(reinterpret_cast<const void*>(descendants));
+      __builtin_prefetch(
+          reinterpret_cast<const void*>(descendants + kCacheLineSize));
+      k = 2 * k + (keys[k] <= ra);
+    }
+    // Undo the final run of left turns and the right turn before it, to
+    // recover the last block starting at or before |ra|.
+    k >>= __builtin_ffsll(k);
+    if (k == 0)
+      return FrameRoots();
+
+    const uint8_t* cursor = stream_.data() + block_offsets_[k];
+    ReturnAddress current = keys[k];
+    uint64_t root_set = ReadVarint(&cursor);
+    while (current < ra) {
+      uint64_t delta = ReadVarint(&cursor);
+      if (delta == 0)
+        return FrameRoots();
+      current += delta;
+      root_set = ReadVarint(&cursor);
+    }
+    if (current != ra)
+      return FrameRoots();
+    return root_sets_[root_set].Get(pool_.data());
+  }
+
+  size_t size() const { return num_safepoints_; }
+
+  size_t num_root_sets() const { return root_sets_.size(); }
+
+  // The bytes taken up by the table's arrays.
+  size_t memory_usage() const;
+
+  // Calls |fn| with the return address and roots of every safepoint, in no
+  // particular order.
+  template <typename Fn>
+  void ForEach(Fn fn) const {
+    for (size_t k = 1; k < keys_.size(); k++) {
+      const uint8_t* cursor = stream_.data() + block_offsets_[k];
+      ReturnAddress ra = keys_[k];
+      while (true) {
+        fn(ra, root_sets_[ReadVarint(&cursor)].Get(pool_.data()));
+        uint64_t delta = ReadVarint(&cursor);
+        if (delta == 0)
+          break;
+        ra += delta;
+      }
+    }
+  }
+
+  void Print() const;
+
+ private:
+  static constexpr size_t kPrefetchStride = 16;
+  static constexpr size_t kCacheLineSize = 64;
+
+  // Allocates the keys on a cache line boundary, so that each run of
+  // kPrefetchStride descendants starts on one too.
+  template <typename T>
+  struct CacheLineAllocator {
+    using value_type = T;
+
+    CacheLineAllocator() = default;
+    template <typename U>
+    CacheLineAllocator(const CacheLineAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+      return static_cast<T*>(::operator new(
+          n * sizeof(T), std::align_val_t(kCacheLineSize)));
+    }
+    void deallocate(T* p, size_t) {
+      ::operator delete(p, std::align_val_t(kCacheLineSize));
+    }
+
+    bool operator==(const CacheLineAllocator&) const { return true; }
+    bool operator!=(const CacheLineAllocator&) const { return false; }
+  };
+
+  // The number of safepoints in a block. Larger blocks make the table smaller
+  // but lookups decode further on average.
+  static constexpr size_t kBlockSize = 16;
+
+  static uint64_t ReadVarint(const uint8_t** cursor) {
+    const uint8_t* p = *cursor;
+    uint64_t value = *p & 0x7f;
+    for (int shift = 7; *p++ & 0x80; shift += 7)
+      value |= static_cast<uint64_t>(*p & 0x7f) << shift;
+    *cursor = p;
+    return value;
+  }
+
+  // Both arrays are 1-indexed, as is conventional for Eytzinger layouts; slot
+  // 0 is unused.
+  std::vector<ReturnAddress, CacheLineAllocator<ReturnAddress>> keys_;
+  std::vector<uint32_t> block_offsets_;
+
+  std::vector<uint8_t> stream_;
+  std::vector<RootSet> root_sets_;
+  std::vector<uint32_t> pool_;
+  size_t num_safepoints_ = 0;
+};
+
+#endif  // TOOLS_CLANG_STACK_MAPS_GC_SAFEPOINT_TABLE_H_
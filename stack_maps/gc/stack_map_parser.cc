@@ -4,11 +4,136 @@
 
 #include "stack_map_parser.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 namespace stackmap {
 
-FrameRoots StackmapV3Parser::ParseFrame() {
-  std::vector<DWARF> reg_roots;
-  std::vector<RBPOffset> stack_roots;
+namespace {
+
+// Stops the program when the frames of the function at |address| cannot be
+// walked. Unlike an assert, this holds in release builds too, as walking such
+// a frame would relocate the wrong slots.
+[[noreturn]] void Unwalkable(uint64_t address, const char* reason) {
+  fprintf(stderr, "Cannot walk the frames of function %p: %s\n",
+          reinterpret_cast<void*>(address), reason);
+  abort();
+}
+
+}  // namespace
+
+CalleeSaves StackmapV3Parser::DecodeCalleeSaves(const StkSizeRecord* fn,
+                                                bool* has_frame_pointer) {
+  static constexpr uint8_t kEndbr64[] = {0xf3, 0x0f, 0x1e, 0xfa};
+  static constexpr uint8_t kPushRBP = 0x55;
+  static constexpr uint8_t kPushRBX = 0x53;
+  static constexpr uint8_t kPushRAX = 0x50;
+  static constexpr uint8_t kREXB = 0x41;  // Selects R8-R15 in a push
+  static constexpr uint8_t kPushR12 = 0x54;
+  static constexpr uint8_t kPushR15 = 0x57;
+  static constexpr uint8_t kSubRSPImm8[] = {0x48, 0x83, 0xec};
+  static constexpr uint8_t kSubRSPImm32[] = {0x48, 0x81, 0xec};
+
+  const uint8_t* code = read_code_(fn->address);
+  if (memcmp(code, kEndbr64, sizeof(kEndbr64)) == 0)
+    code += sizeof(kEndbr64);
+
+  CalleeSaves saves = 0;
+  uint64_t pushed = 0;
+  int last = kNumCalleeSavedRegs;
+  *has_frame_pointer = false;
+  while (true) {
+    DWARF reg;
+    if (code[0] == kPushRBP) {
+      reg = kDwarfRBP;
+      code += 1;
+    } else if (code[0] == kPushRBX) {
+      reg = 3;
+      code += 1;
+    } else if (code[0] == kREXB && code[1] >= kPushR12 &&
+               code[1] <= kPushR15) {
+      reg = 12 + (code[1] - kPushR12);
+      code += 2;
+    } else {
+      break;
+    }
+    int index = CalleeSavedIndex(reg);
+    if (index >= last)
+      Unwalkable(fn->address, "callee-saved registers pushed out of order");
+    saves |= 1 << index;
+    pushed += 8;
+    last = index;
+
+    // Either encoding of mov %rsp, %rbp.
+    if (reg == kDwarfRBP && code[0] == 0x48 &&
+        ((code[1] == 0x89 && code[2] == 0xe5) ||
+         (code[1] == 0x8b && code[2] == 0xec))) {
+      *has_frame_pointer = true;
+      code += 3;
+    }
+  }
+
+  // A frame of variable size is set up by a prologue which starts with its
+  // frame pointer, so the prologue is at the entry.
+  if (fn->stack_size == kVariableStackSize) {
+    if (!*has_frame_pointer)
+      Unwalkable(fn->address, "frame of variable size has no frame pointer");
+    return saves;
+  }
+
+  // Otherwise the pushes are only all of the callee saves if the prologue is
+  // at the entry, which it is not if it was shrink-wrapped into a later block.
+  // The prologue at the entry allocates the rest of the frame straight after
+  // its pushes, with a sub from RSP or, for a single word, a push of RAX.
+  int64_t allocated = 0;
+  if (memcmp(code, kSubRSPImm8, sizeof(kSubRSPImm8)) == 0) {
+    allocated = static_cast<int8_t>(code[3]);
+  } else if (memcmp(code, kSubRSPImm32, sizeof(kSubRSPImm32)) == 0) {
+    int32_t imm;
+    memcpy(&imm, code + 3, sizeof(imm));
+    allocated = imm;
+  } else if (code[0] == kPushRAX) {
+    allocated = 8;
+  }
+  if (fn->stack_size != pushed + allocated) {
+    Unwalkable(fn->address,
+               "prologue is not at the function entry, build with "
+               "-mllvm --enable-shrink-wrap=false");
+  }
+  return saves;
+}
+
+namespace {
+
+bool SameLocation(const StkMapLocation* a, const StkMapLocation* b) {
+  return a->kind == b->kind && a->reg_num == b->reg_num &&
+         a->offset == b->offset;
+}
+
+// Returns the location of a base or derived pointer, which must be either in a
+// callee-saved register or spilled to the stack.
+RootLocation GetRootLocation(const StkMapLocation* loc) {
+  if (loc->kind == kRegister) {
+    assert(CalleeSavedIndex(loc->reg_num) >= 0 &&
+           "Root is live across a call in a caller-saved register");
+    return MakeRegisterLocation(loc->reg_num);
+  }
+  assert(loc->kind == kIndirect &&
+         "Derived pointer is neither in a register nor spilled");
+  assert((loc->reg_num == kDwarfRBP || loc->reg_num == kDwarfRSP) &&
+         "Stack root is not addressed relative to RSP or RBP");
+  return MakeStackRoot(loc->reg_num, loc->offset);
+}
+
+}  // namespace
+
+void StackmapV3Parser::ParseFrame(std::vector<DWARF>* reg_roots,
+                                  std::vector<StackRoot>* stack_roots,
+                                  std::vector<DerivedRoot>* derived_roots) {
+  reg_roots->clear();
+  stack_roots->clear();
+  derived_roots->clear();
 
   auto* loc =
       ptr_offset<const StkMapLocation*>(cur_frame_, sizeof(StkMapRecordHeader));
@@ -30,15 +155,28 @@ FrameRoots StackmapV3Parser::ParseFrame() {
   int gc_locs = (cur_frame_->num_locations - (num_deopts + 1) - kSkipLocs);
 
   // Locations come in pairs of a base pointer followed by a derived pointer.
-  // At the moment we assume derived pointers are the same as base pointers so
-  // we skip over them.
+  // A pair whose derived pointer is the base pointer itself is an ordinary
+  // root. Otherwise the derived pointer points into the object of its base and
+  // must be relocated along with it.
   for (uint16_t i = 0; i < gc_locs; i += 2) {
+    const StkMapLocation* derived = loc + 1;
+    if (!SameLocation(loc, derived)) {
+      derived_roots->push_back(
+          {GetRootLocation(loc), GetRootLocation(derived)});
+      loc += 2;
+      continue;
+    }
+
     switch (loc->kind) {
       case kRegister:
-        reg_roots.push_back(loc->reg_num);
+        assert(CalleeSavedIndex(loc->reg_num) >= 0 &&
+               "Root is live across a call in a caller-saved register");
+        reg_roots->push_back(loc->reg_num);
         break;
       case kIndirect:
-        stack_roots.push_back(loc->offset);
+        assert((loc->reg_num == kDwarfRBP || loc->reg_num == kDwarfRSP) &&
+               "Stack root is not addressed relative to RSP or RBP");
+        stack_roots->push_back(MakeStackRoot(loc->reg_num, loc->offset));
         break;
       default:
         // Ignore
@@ -58,7 +196,6 @@ FrameRoots StackmapV3Parser::ParseFrame() {
   // LLVM V3 stackmap format requires padding here if we need to align to an 8
   // byte boundary.
   cur_frame_ = align_8(ptr_offset<const StkMapRecordHeader*>(liveouts, incr));
-  return FrameRoots(reg_roots, stack_roots);
 }
 
 SafepointTable StackmapV3Parser::Parse() {
@@ -78,22 +215,39 @@ SafepointTable StackmapV3Parser::Parse() {
   // For each function in the stack map, we iterate over the stack map record
   // list looking for its respective callsite, adding its entry to the table.
   auto* fn = ptr_offset<const StkSizeRecord*>(cursor_, sizeof(StkMapHeader));
-  std::map<ReturnAddress, FrameRoots> roots;
+  SafepointTable::Builder builder;
+  std::vector<DWARF> reg_roots;
+  std::vector<StackRoot> stack_roots;
+  std::vector<DerivedRoot> derived_roots;
   for (uint32_t i = 0; i < header->num_functions; i++) {
+    bool has_frame_pointer;
+    CalleeSaves saves = DecodeCalleeSaves(fn, &has_frame_pointer);
+
+    // The stack size excludes the return address.
+    FrameSize frame_size = kUnknownFrameSize;
+    if (fn->stack_size < 8 * uint64_t{UINT16_MAX}) {
+      assert(fn->stack_size % 8 == 0 && "Misaligned stack frame");
+      frame_size = fn->stack_size / 8 + 1;
+    }
+    if (!has_frame_pointer && frame_size == kUnknownFrameSize)
+      Unwalkable(fn->address, "frame without a frame pointer is too large");
+
+    // The walker steps over frames without a safepoint by their frame pointer,
+    // which is all a frame needs if it has no roots and saves no registers
+    // other than RBP. Otherwise, safepoints without roots are still needed.
+    bool needs_safepoints = !has_frame_pointer || saves != (1 << kRBPIndex);
     for (uint32_t j = 0; j < fn->record_count; j++) {
       ReturnAddress key = fn->address + cur_frame_->return_addr;
-      auto frame_roots = ParseFrame();
-      if (!frame_roots.empty())
-        roots.insert({key, frame_roots});
+      ParseFrame(&reg_roots, &stack_roots, &derived_roots);
+      if (!reg_roots.empty() || !stack_roots.empty() ||
+          !derived_roots.empty() || needs_safepoints) {
+        builder.Add(key, reg_roots, stack_roots, derived_roots, saves,
+                    frame_size);
+      }
     }
     fn++;
   }
 
-  return SafepointTable(roots);
+  return builder.Build();
 }
 }  // namespace stackmap
-
-SafepointTable GenSafepointTable() {
-  auto parser = stackmap::StackmapV3Parser();
-  return parser.Parse();
-}
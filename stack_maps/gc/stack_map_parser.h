@@ -5,7 +5,13 @@
 #ifndef TOOLS_CLANG_STACK_MAPS_GC_STACK_MAP_PARSER_H_
 #define TOOLS_CLANG_STACK_MAPS_GC_STACK_MAP_PARSER_H_
 
-#include "gc_api.h"
+#include <assert.h>
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "safepoint_table.h"
 
 // The stackmap section in the binary has a non-trivial layout. We give it a
 // char type so it can be iterated byte-by-byte, and re-cast as necessary by the
@@ -116,7 +122,19 @@ struct __attribute__((packed)) LiveOut {
 // versioned and *not* backwards compatible.
 class StackmapV3Parser {
  public:
-  StackmapV3Parser() : cursor_(&__LLVM_StackMaps) {}
+  // Returns a pointer to the code at a function address from the stackmap.
+  using CodeReader = std::function<const uint8_t*(uint64_t address)>;
+
+  StackmapV3Parser()
+      : cursor_(&__LLVM_StackMaps), read_code_([](uint64_t address) {
+          return reinterpret_cast<const uint8_t*>(address);
+        }) {}
+
+  // Parses a copy of a stackmap section, e.g. one read from an ELF file by an
+  // offline tool. Function addresses in the copy must already be relocated,
+  // and |read_code| must find the code of the functions they refer to.
+  StackmapV3Parser(const char* section, CodeReader read_code)
+      : cursor_(section), read_code_(std::move(read_code)) {}
 
   SafepointTable Parse();
 
@@ -124,9 +142,29 @@ class StackmapV3Parser {
   static constexpr uint8_t kStackmapVersion = 3;
   static constexpr uint8_t kSizeConstantEntry = 8;  // size in bytes
   static constexpr uint8_t kSkipLocs = 2;
+  // The stack size recorded for frames with variable sized objects, or which
+  // are realigned.
+  static constexpr uint64_t kVariableStackSize = UINT64_MAX;
 
   const char* cursor_;
   const StkMapRecordHeader* cur_frame_;
+  CodeReader read_code_;
+
+  // Decodes which callee-saved registers a function pushes from its prologue,
+  // and whether it sets up a frame pointer. The prologue has the form:
+  //
+  //    [endbr64]
+  //    [push %rbp]
+  //    [mov  %rsp, %rbp]              (only with a frame pointer)
+  //    push <callee-saved register>   (zero or more)
+  //    [sub $n, %rsp | push %rax]
+  //
+  // which leaves the save slots of the pushed registers directly below the
+  // return address. Aborts, whether or not assertions are enabled, if the
+  // prologue does not allocate the stack size which the stack map of |fn|
+  // records, as it does not if it is not at the function's entry.
+  CalleeSaves DecodeCalleeSaves(const StkSizeRecord* fn,
+                                bool* has_frame_pointer);
 
   // Get a new pointer of the same type to the one passed in arg0 + some byte(s)
   // offset. Useful to prevent littering code with constant char* casting when
@@ -172,7 +210,13 @@ class StackmapV3Parser {
   //        uint8  : Reserved
   //        uint8  : Size in Bytes
   //      }
-  FrameRoots ParseFrame();
+  //
+  // The roots found are written to |reg_roots|, |stack_roots| and
+  // |derived_roots|, which are cleared first so that the caller can reuse them
+  // across records.
+  void ParseFrame(std::vector<DWARF>* reg_roots,
+                  std::vector<StackRoot>* stack_roots,
+                  std::vector<DerivedRoot>* derived_roots);
 };
 
 }  // namespace stackmap
@@ -0,0 +1,150 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Generates the contents of the `.gc_safepoints` section for a linked ELF
+// executable from its `.llvm_stackmaps` section. See safepoint_index.h for the
+// format. The output is added to the executable as a non-allocated section, so
+// the layout of the loaded image is unchanged. The section's alignment can only
+// be set once it exists:
+//
+//   gen_safepoint_index a.out a.out.gcidx
+//   objcopy --add-section .gc_safepoints=a.out.gcidx a.out
+//   objcopy --set-section-alignment .gc_safepoints=8 a.out
+
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "safepoint_index.h"
+#include "stack_map_parser.h"
+
+namespace {
+
+constexpr char kStackmapSection[] = ".llvm_stackmaps";
+
+bool ReadFile(const char* path, std::vector<char>* out) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    return false;
+  out->assign(std::istreambuf_iterator<char>(in),
+              std::istreambuf_iterator<char>());
+  return true;
+}
+
+// Copies the stackmap section out of |elf| into |section| and returns its
+// link-time address, or 0 if there is none. |*hash| is set to the hash of the
+// section as stored in the file, which the runtime compares against its own.
+//
+// In a position independent executable the function addresses in the stackmap
+// are resolved by R_X86_64_RELATIVE dynamic relocations, so those are applied
+// to the copy. Their addends are link-time addresses, like the ones a non-PIE
+// executable has in place.
+uint64_t ExtractStackmapSection(const std::vector<char>& elf,
+                                std::vector<char>* section,
+                                uint64_t* hash) {
+  if (elf.size() < sizeof(Elf64_Ehdr))
+    return 0;
+  auto* ehdr = reinterpret_cast<const Elf64_Ehdr*>(elf.data());
+  if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+      ehdr->e_ident[EI_CLASS] != ELFCLASS64 ||
+      ehdr->e_machine != EM_X86_64 ||
+      ehdr->e_shoff + ehdr->e_shnum * sizeof(Elf64_Shdr) > elf.size()) {
+    return 0;
+  }
+
+  auto* shdrs = reinterpret_cast<const Elf64_Shdr*>(elf.data() + ehdr->e_shoff);
+  const char* names = elf.data() + shdrs[ehdr->e_shstrndx].sh_offset;
+
+  const Elf64_Shdr* stackmaps = nullptr;
+  for (int i = 0; i < ehdr->e_shnum; i++) {
+    if (strcmp(names + shdrs[i].sh_name, kStackmapSection) == 0)
+      stackmaps = &shdrs[i];
+  }
+  if (!stackmaps || stackmaps->sh_offset + stackmaps->sh_size > elf.size())
+    return 0;
+
+  auto* begin = elf.data() + stackmaps->sh_offset;
+  section->assign(begin, begin + stackmaps->sh_size);
+  *hash = SafepointIndex::HashStackmaps(begin, stackmaps->sh_size);
+
+  uint64_t start = stackmaps->sh_addr;
+  uint64_t end = start + stackmaps->sh_size;
+  for (int i = 0; i < ehdr->e_shnum; i++) {
+    if (shdrs[i].sh_type != SHT_RELA)
+      continue;
+    auto* relas =
+        reinterpret_cast<const Elf64_Rela*>(elf.data() + shdrs[i].sh_offset);
+    for (size_t j = 0; j < shdrs[i].sh_size / sizeof(Elf64_Rela); j++) {
+      const Elf64_Rela& rela = relas[j];
+      if (ELF64_R_TYPE(rela.r_info) != R_X86_64_RELATIVE ||
+          rela.r_offset < start || rela.r_offset + sizeof(uint64_t) > end) {
+        continue;
+      }
+      uint64_t value = rela.r_addend;
+      memcpy(section->data() + (rela.r_offset - start), &value, sizeof(value));
+    }
+  }
+  return start;
+}
+
+// Returns the contents of |elf| at the link-time address |address|, which must
+// be in an executable section.
+const uint8_t* ReadCode(const std::vector<char>& elf, uint64_t address) {
+  auto* ehdr = reinterpret_cast<const Elf64_Ehdr*>(elf.data());
+  auto* shdrs = reinterpret_cast<const Elf64_Shdr*>(elf.data() + ehdr->e_shoff);
+  for (int i = 0; i < ehdr->e_shnum; i++) {
+    const Elf64_Shdr& shdr = shdrs[i];
+    if ((shdr.sh_flags & SHF_EXECINSTR) && shdr.sh_type == SHT_PROGBITS &&
+        address >= shdr.sh_addr && address < shdr.sh_addr + shdr.sh_size) {
+      return reinterpret_cast<const uint8_t*>(elf.data() + shdr.sh_offset +
+                                              (address - shdr.sh_addr));
+    }
+  }
+  fprintf(stderr, "Function %p is not in an executable section\n",
+          reinterpret_cast<void*>(address));
+  exit(1);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s <executable> <output>\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<char> elf;
+  if (!ReadFile(argv[1], &elf)) {
+    fprintf(stderr, "Could not read %s\n", argv[1]);
+    return 1;
+  }
+
+  std::vector<char> section;
+  uint64_t section_hash;
+  uint64_t section_addr = ExtractStackmapSection(elf, &section, &section_hash);
+  if (!section_addr) {
+    fprintf(stderr, "%s has no %s section\n", argv[1], kStackmapSection);
+    return 1;
+  }
+
+  auto parser = stackmap::StackmapV3Parser(
+      section.data(),
+      [&elf](uint64_t address) { return ReadCode(elf, address); });
+  SafepointTable table = parser.Parse();
+  std::vector<char> index =
+      SafepointIndex::Build(table, section_addr, section_hash);
+
+  std::ofstream out(argv[2], std::ios::binary);
+  out.write(index.data(), index.size());
+  if (!out) {
+    fprintf(stderr, "Could not write %s\n", argv[2]);
+    return 1;
+  }
+  return 0;
+}
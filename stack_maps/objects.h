@@ -5,14 +5,17 @@
 #ifndef TOOLS_CLANG_STACK_MAPS_OBJECTS_H_
 #define TOOLS_CLANG_STACK_MAPS_OBJECTS_H_
 
+#include <assert.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #define GC_AS __attribute__((address_space(1)))
 
 // This should be used only when finer control is needed to prevent statepoint
 // insertion. It must not be used on functions which will have a pointer on the
-// stack across a GC. It should be used very carefully as it overrides the
-// default statepointing mechanism.
+// stack across a GC, and such a function's callers must not keep a root in a
+// callee-saved register across a call to it which collects. It should be used
+// very carefully as it overrides the default statepointing mechanism.
 #define NO_STATEPOINT \
   __attribute__((noinline)) __attribute__((annotate("no-statepoint")))
 
@@ -38,6 +41,14 @@ class Handle {
     return Handle<T>(gcptr);
   }
 
+  // Copies the pointer as a managed pointer. A trivial copy would be a memcpy,
+  // which the optimiser turns into a store of an integer, and the stack write
+  // barrier would not see a Handle being stored through a Handle<T>*.
+  Handle<T>& operator=(const Handle<T>& other) {
+    address = other.address;
+    return *this;
+  }
+
   T operator*() const {
     long data = *(long GC_AS*)address;
     return HeapObject(data);
@@ -48,4 +59,189 @@ class Handle {
   Handle<T>(Address address) : address(address) {}
 };
 
+// Calls the collector, which will move the underlying heap objects and update
+// pointer values on the stack.
+extern "C" void GC();
+
+// Set by the collector while it waits for the mutator threads to stop at
+// safepoints. It is accessed atomically.
+extern int gc_safepoint_requested;
+
+// Parks the calling thread until the requested collection is over. This is an
+// assembly shim which, like GC, makes the thread's stack walkable first.
+extern "C" void GCSafepoint();
+
+// The safepoint poll, which the place-safepoint-polls pass inlines at the entry
+// of each function with stack maps and on loop backedges, so that every thread
+// running managed code reaches a safepoint soon after a collection is
+// requested. The pass finds it by its symbol name, so it must be emitted in
+// each module even though nothing calls it directly.
+inline __attribute__((used)) void SafepointPoll() __asm__("gc.safepoint_poll");
+inline void SafepointPoll() {
+  if (__atomic_load_n(&gc_safepoint_requested, __ATOMIC_RELAXED))
+    GCSafepoint();
+}
+
+// The address range of the heap: the nursery, followed by the old generation.
+// The write barrier checks stores against it.
+struct HeapRange {
+  uintptr_t nursery_start;
+  uintptr_t nursery_end;
+  uintptr_t end;
+};
+
+extern HeapRange gc_heap_range;
+
+// Adds |slot| to the calling thread's part of the remembered set. This is the
+// slow path of the write barrier.
+extern "C" void GCRememberSlot(Address GC_AS* slot);
+
+// The write barrier, which the insert-write-barriers pass inlines after every
+// store of a managed pointer into the heap. A store which makes an old object
+// point into the nursery is recorded, so that the next minor collection can
+// update the slot without scanning the old generation.
+// Pointer fields must therefore only be written through GC_AS pointers.
+inline __attribute__((used)) void WriteBarrier(Address GC_AS* slot,
+                                               Address value)
+    __asm__("gc.write_barrier");
+inline void WriteBarrier(Address GC_AS* slot, Address value) {
+  // C style casts, as reinterpret_cast cannot remove the address space.
+  auto slot_address = (uintptr_t)slot;
+  auto value_address = (uintptr_t)value;
+  const HeapRange& range = gc_heap_range;
+  if (value_address - range.nursery_start <
+          range.nursery_end - range.nursery_start &&
+      slot_address >= range.nursery_end && slot_address < range.end) {
+    GCRememberSlot(slot);
+  }
+}
+
+// A stack barrier: a return address in a thread's stack which has been replaced
+// by the address of GCStackBarrier. Every frame above the patched slot has been
+// suspended since the last collection, which promoted every object they point
+// to, so a minor collection need not scan them. When the frame below the slot
+// returns into the trampoline, it moves the barrier up to the return address of
+// the frame it returns to, which is running again, and jumps to
+// |return_address|. The barrier is removed once the frame it would move to is
+// the thread's top of stack. Frames must therefore only be left by returning,
+// not by unwinding or longjmp.
+struct StackBarrier {
+  // The patched slot, or null if the thread has no barrier.
+  uintptr_t* slot;
+  uintptr_t return_address;
+  uintptr_t top_of_stack;
+};
+
+extern "C" __thread StackBarrier gc_stack_barrier;
+
+// Records |slot|, which lies in a frame above the calling thread's stack
+// barrier, as a root of the next collection. This is the slow path of the
+// stack write barrier.
+extern "C" void GCRememberStackSlot(Address* slot);
+
+// The stack write barrier, which the insert-write-barriers pass inlines after
+// every store of a managed pointer through a pointer which may point into
+// another frame, such as an out-parameter or a Handle<T>*. A frame above the
+// stack barrier may only point into the old generation, so a store which makes
+// it point into the nursery is recorded, as minor collections do not scan it.
+inline __attribute__((used)) void StackWriteBarrier(Address* slot,
+                                                    Address value)
+    __asm__("gc.stack_write_barrier");
+inline void StackWriteBarrier(Address* slot, Address value) {
+  auto slot_address = reinterpret_cast<uintptr_t>(slot);
+  auto value_address = (uintptr_t)value;
+  const HeapRange& range = gc_heap_range;
+  const StackBarrier& barrier = gc_stack_barrier;
+  auto barrier_address = reinterpret_cast<uintptr_t>(barrier.slot);
+  if (value_address - range.nursery_start <
+          range.nursery_end - range.nursery_start &&
+      barrier_address && slot_address > barrier_address &&
+      slot_address < barrier.top_of_stack) {
+    GCRememberStackSlot(slot);
+  }
+}
+
+// Returns the header word which precedes the payload of a heap object with
+// |num_words| words of payload, the first |num_pointers| of which are traced
+// pointer fields.
+inline uintptr_t MakeObjectHeader(size_t num_words, size_t num_pointers) {
+  return (static_cast<uintptr_t>(num_words) << 32) | (num_pointers << 1);
+}
+
+// A thread-local allocation buffer: a chunk of the heap reserved by a single
+// thread, which it bump-allocates from without synchronising with other
+// threads. Only refilling it from the heap's shared space is atomic. An empty
+// buffer has both pointers null.
+struct AllocationBuffer {
+  char* top;
+  char* limit;
+};
+
+extern __thread AllocationBuffer gc_allocation_buffer;
+
+// Allocates |num_words| words of payload on the heap, the first |num_pointers|
+// of which are traced pointer fields. Returns nullptr if the heap is full. This
+// is the slow path of TryAllocate, which refills the calling thread's
+// allocation buffer. It never collects: the runtime's frames have no stack
+// maps, so collections must be triggered from the mutator's own frames
+// instead.
+extern "C" long* GCTryAllocate(size_t num_words, size_t num_pointers);
+
+// Bump-allocates an object from |buffer|, or returns nullptr if it does not
+// fit in what is left of the buffer.
+__attribute__((always_inline)) inline long* AllocateInBuffer(
+    AllocationBuffer* buffer,
+    size_t num_words,
+    size_t num_pointers) {
+  size_t size = (num_words + 1) * sizeof(uintptr_t);
+  if (size > static_cast<size_t>(buffer->limit - buffer->top))
+    return nullptr;
+
+  auto* header = reinterpret_cast<uintptr_t*>(buffer->top);
+  buffer->top += size;
+  *header = MakeObjectHeader(num_words, num_pointers);
+  auto* payload = reinterpret_cast<long*>(header + 1);
+  for (size_t i = 0; i < num_pointers; i++)
+    payload[i] = 0;
+  return payload;
+}
+
+// The allocation fast path, which is inlined into the mutator. It only falls
+// back to the runtime when the thread's allocation buffer is exhausted.
+__attribute__((always_inline)) inline long* TryAllocate(size_t num_words,
+                                                        size_t num_pointers) {
+  long* ptr = AllocateInBuffer(&gc_allocation_buffer, num_words, num_pointers);
+  if (ptr)
+    return ptr;
+  return GCTryAllocate(num_words, num_pointers);
+}
+
+// Returns |ptr|, the address of a newly allocated object, as a managed pointer.
+// Like Handle::New, the cast is kept out of line: statepoint rewriting can only
+// relocate managed pointers which do not come from an address space cast in
+// the same function.
+template <typename T>
+NO_STATEPOINT T GC_AS* AsManaged(T* ptr) {
+  return (T GC_AS*)ptr;
+}
+
+// A very simple allocator for a HeapObject. For the purposes of this
+// experiment, a HeapObject's contents is simply a 64 bit integer. The data
+// itself is not important, what is, however, is that it can be accessed through
+// the rootset after the collector moves it.
+//
+// This is always inlined so that a collection on a full heap is triggered
+// directly from the allocating function's frame.
+__attribute__((always_inline)) inline Handle<HeapObject> AllocateHeapObject(
+    long data) {
+  long* ptr = TryAllocate(1, 0);
+  if (!ptr) {
+    GC();
+    ptr = TryAllocate(1, 0);
+    assert(ptr && "Allocation failed: Heap full");
+  }
+  *ptr = data;
+  return Handle<HeapObject>::New(reinterpret_cast<HeapObject*>(ptr));
+}
+
 #endif  // TOOLS_CLANG_STACK_MAPS_OBJECTS_H_
@@ -5,9 +5,13 @@
 #ifndef TOOLS_CLANG_STACK_MAPS_TESTS_H_
 #define TOOLS_CLANG_STACK_MAPS_TESTS_H_
 
+#include <stddef.h>
+
 // Initialises the GC by setting up the heap and marking top of stack so the
-// gc knows where to stop during walking.
+// gc knows where to stop during walking. The heap's old generation is
+// |old_space_size| bytes, or a default size if none is given.
 extern void InitGC();
+extern void InitGC(size_t old_space_size);
 
 // Calls the collector, which will move the underlying heap objects and update
 // pointer values on the stack.
@@ -16,4 +20,14 @@ extern "C" void GC();
 // Frees all heap memory
 extern void TeardownGC();
 
+// Registers the calling thread with the GC, so that its stack is scanned when
+// any thread collects, and unregisters it again. Each thread other than the one
+// which called InitGC must attach before it runs managed code.
+extern void AttachThread();
+extern void DetachThread();
+
+// Calls fn(arg) while allowing other threads to collect, e.g. to join a thread
+// or wait on a lock. |fn| must not touch the heap.
+extern "C" void GCBlockingCall(void (*fn)(void*), void* arg);
+
 #endif  // TOOLS_CLANG_STACK_MAPS_TESTS_H_
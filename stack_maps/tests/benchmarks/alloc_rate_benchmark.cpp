@@ -0,0 +1,66 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures the allocation throughput of the inlined allocation fast path, for
+// single word objects and for larger objects. Collections are triggered from
+// the allocating loop whenever the nursery fills up. Everything allocated is
+// garbage by the next collection, except for one object which must survive all
+// of them.
+//
+// Usage: alloc_rate_benchmark [allocations]
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "benchmark.h"
+#include "objects.h"
+#include "tests.h"
+
+constexpr long kDefaultAllocations = 20000000;
+constexpr size_t kLargeObjectWords = 16;
+
+// Each object is preceded by a one word header.
+constexpr size_t kSmallObjectBytes = 2 * sizeof(long);
+constexpr size_t kLargeObjectBytes = (kLargeObjectWords + 1) * sizeof(long);
+
+__attribute__((noinline)) size_t AllocateSmallObjects(long num_allocations) {
+  auto survivor = AllocateHeapObject(-1);
+  for (long i = 0; i < num_allocations; i++)
+    AllocateHeapObject(i);
+  assert((*survivor).data == -1 && "GC Objects differ across a collection");
+  return num_allocations * kSmallObjectBytes;
+}
+
+__attribute__((noinline)) size_t AllocateLargeObjects(long num_allocations) {
+  auto survivor = AllocateHeapObject(-1);
+  for (long i = 0; i < num_allocations; i++) {
+    long* ptr = TryAllocate(kLargeObjectWords, 0);
+    if (!ptr) {
+      GC();
+      ptr = TryAllocate(kLargeObjectWords, 0);
+      assert(ptr && "Allocation failed: Heap full");
+    }
+    ptr[0] = i;
+  }
+  assert((*survivor).data == -1 && "GC Objects differ across a collection");
+  return num_allocations * kLargeObjectBytes;
+}
+
+int main(int argc, char** argv) {
+  long num_allocations = argc > 1 ? atol(argv[1]) : kDefaultAllocations;
+  InitGC();
+
+  GCRecorder recorder;
+  recorder.Start();
+  size_t bytes = AllocateSmallObjects(num_allocations);
+  recorder.Report("alloc_rate_small", bytes);
+
+  // Large objects fill the nursery faster, so fewer are allocated.
+  recorder.Start();
+  bytes = AllocateLargeObjects(num_allocations / 8);
+  recorder.Report("alloc_rate_large", bytes);
+
+  TeardownGC();
+  return 0;
+}
@@ -0,0 +1,102 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLS_CLANG_STACK_MAPS_TESTS_BENCHMARKS_BENCHMARK_H_
+#define TOOLS_CLANG_STACK_MAPS_TESTS_BENCHMARKS_BENCHMARK_H_
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "gc/gc_control.h"
+
+// Records every collection between Start and Report, and prints what a
+// benchmark measured as one "<benchmark>.<metric> <value>" line per metric, in
+// a fixed order, so that the output of two runs can be diffed. Only one
+// recorder can be running at a time.
+class GCRecorder {
+ public:
+  void Start() {
+    pauses_.clear();
+    frames_scanned_ = 0;
+    scan_ns_ = 0;
+    compact_ns_ = 0;
+    max_fragmentation_ = 0;
+    full_collections_at_start_ = GetGCStats().num_full_collections;
+    full_collections_seen_ = full_collections_at_start_;
+    current_ = this;
+    SetGCCallback(&GCRecorder::OnCollection);
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  // Stops recording, and reports the collections along with the allocation
+  // throughput of the |bytes_allocated| allocated since Start.
+  void Report(const char* benchmark, size_t bytes_allocated) {
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start_)
+                         .count();
+    SetGCCallback(nullptr);
+    current_ = nullptr;
+
+    Print(benchmark, "seconds", seconds);
+    Print(benchmark, "allocated_mb", bytes_allocated / 1e6);
+    Print(benchmark, "allocated_mb_per_s", bytes_allocated / 1e6 / seconds);
+    Print(benchmark, "collections", pauses_.size());
+    Print(benchmark, "full_collections",
+          GetGCStats().num_full_collections - full_collections_at_start_);
+    Print(benchmark, "pause_p50_us", Percentile(0.5));
+    Print(benchmark, "pause_p90_us", Percentile(0.9));
+    Print(benchmark, "pause_p99_us", Percentile(0.99));
+    Print(benchmark, "pause_max_us", Percentile(1));
+    Print(benchmark, "frames_scanned", frames_scanned_);
+    Print(benchmark, "scan_ns_per_frame",
+          frames_scanned_ ? static_cast<double>(scan_ns_) / frames_scanned_
+                          : 0);
+    Print(benchmark, "compact_us", compact_ns_ / 1e3);
+    Print(benchmark, "fragmentation_max", max_fragmentation_);
+  }
+
+ private:
+  static void OnCollection(const GCStats& stats) {
+    current_->pauses_.push_back(stats.last_pause_ns / 1e3);
+    current_->frames_scanned_ += stats.last_frames_scanned;
+    current_->scan_ns_ += stats.last_scan_ns;
+    if (stats.num_full_collections > current_->full_collections_seen_) {
+      current_->compact_ns_ += stats.last_compact_ns;
+      current_->max_fragmentation_ =
+          std::max(current_->max_fragmentation_, stats.last_fragmentation);
+    }
+    current_->full_collections_seen_ = stats.num_full_collections;
+  }
+
+  static void Print(const char* benchmark, const char* metric, double value) {
+    printf("%s.%s %.3f\n", benchmark, metric, value);
+  }
+
+  static void Print(const char* benchmark, const char* metric, size_t value) {
+    printf("%s.%s %zu\n", benchmark, metric, value);
+  }
+
+  double Percentile(double percentile) {
+    if (pauses_.empty())
+      return 0;
+    std::sort(pauses_.begin(), pauses_.end());
+    return pauses_[static_cast<size_t>(percentile * (pauses_.size() - 1))];
+  }
+
+  static inline GCRecorder* current_ = nullptr;
+
+  std::chrono::steady_clock::time_point start_;
+  std::vector<double> pauses_;
+  size_t frames_scanned_ = 0;
+  uint64_t scan_ns_ = 0;
+  uint64_t compact_ns_ = 0;
+  double max_fragmentation_ = 0;
+  size_t full_collections_at_start_ = 0;
+  size_t full_collections_seen_ = 0;
+};
+
+#endif  // TOOLS_CLANG_STACK_MAPS_TESTS_BENCHMARKS_BENCHMARK_H_
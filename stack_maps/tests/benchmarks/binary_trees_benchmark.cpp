@@ -0,0 +1,106 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// The binary-trees benchmark: a long-lived tree is kept alive while many
+// short-lived trees of increasing depth are built and checked, so most
+// collections promote a partly built tree and then find it dead by the next
+// one. The long-lived tree is checked at the end.
+//
+// Usage: binary_trees_benchmark [max_depth]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "benchmark.h"
+#include "objects.h"
+#include "tests.h"
+
+// A tree node: left and right children, and the node's depth.
+using Node = long GC_AS*;
+using NodeFields = Node GC_AS*;
+
+constexpr int kMinDepth = 4;
+constexpr int kDefaultMaxDepth = 16;
+constexpr size_t kOldSpaceSize = 64 << 20;
+
+// Each node, and the boxed value it is built from, is preceded by a one word
+// header.
+constexpr size_t kNodeBytes = 4 * sizeof(long) + 2 * sizeof(long);
+
+size_t bytes_allocated = 0;
+
+__attribute__((noinline)) Node MakeTree(int depth) {
+  // Functions are only given stack maps if they hold a Handle, so the node's
+  // value is boxed in one.
+  auto value = AllocateHeapObject(depth);
+
+  Node left = depth > 0 ? MakeTree(depth - 1) : nullptr;
+  Node right = depth > 0 ? MakeTree(depth - 1) : nullptr;
+
+  long* ptr = TryAllocate(3, 2);
+  if (!ptr) {
+    GC();
+    ptr = TryAllocate(3, 2);
+    if (!ptr) {
+      fprintf(stderr, "Heap too small for the tree\n");
+      exit(1);
+    }
+  }
+  Node node = AsManaged(ptr);
+  NodeFields fields = (NodeFields)node;
+  fields[0] = left;
+  fields[1] = right;
+  node[2] = (*value).data;
+  bytes_allocated += kNodeBytes;
+  return node;
+}
+
+// Returns the number of nodes in the tree. This never collects, so it needs no
+// stack map.
+long CheckTree(Node node) {
+  NodeFields fields = (NodeFields)node;
+  if (!fields[0])
+    return 1;
+  return 1 + CheckTree(fields[0]) + CheckTree(fields[1]);
+}
+
+__attribute__((noinline)) void RunBinaryTrees(int max_depth) {
+  auto anchor = AllocateHeapObject(max_depth);
+
+  long stretch_nodes = CheckTree(MakeTree((*anchor).data + 1));
+  if (stretch_nodes != (2L << (max_depth + 1)) - 1) {
+    fprintf(stderr, "Stretch tree has %ld nodes\n", stretch_nodes);
+    exit(1);
+  }
+
+  Node long_lived = MakeTree(max_depth);
+  for (int depth = kMinDepth; depth <= max_depth; depth += 2) {
+    long iterations = 1L << (max_depth - depth + kMinDepth);
+    long nodes = 0;
+    for (long i = 0; i < iterations; i++)
+      nodes += CheckTree(MakeTree(depth));
+    if (nodes != iterations * ((2L << depth) - 1)) {
+      fprintf(stderr, "Trees of depth %d have %ld nodes\n", depth, nodes);
+      exit(1);
+    }
+  }
+
+  if (CheckTree(long_lived) != (2L << max_depth) - 1) {
+    fprintf(stderr, "Long lived tree corrupted\n");
+    exit(1);
+  }
+}
+
+int main(int argc, char** argv) {
+  int max_depth = argc > 1 ? atoi(argv[1]) : kDefaultMaxDepth;
+  InitGC(kOldSpaceSize);
+
+  GCRecorder recorder;
+  recorder.Start();
+  RunBinaryTrees(max_depth);
+  recorder.Report("binary_trees", bytes_allocated);
+
+  TeardownGC();
+  return 0;
+}
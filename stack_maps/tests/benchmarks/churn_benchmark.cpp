@@ -0,0 +1,84 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures allocation throughput and pauses with several threads allocating
+// short-lived objects at once. Each thread keeps a window of live Handles and
+// replaces one of them every few allocations, so some objects survive a
+// collection or two before dying. Collections are triggered by whichever
+// thread fills the nursery, and stop the others at their safepoint polls.
+//
+// Usage: churn_benchmark [threads] [allocations_per_thread]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <thread>
+#include <vector>
+
+#include "benchmark.h"
+#include "objects.h"
+#include "tests.h"
+
+constexpr long kDefaultThreads = 4;
+constexpr long kDefaultAllocations = 5000000;
+constexpr long kReplaceInterval = 64;
+
+// Each object is preceded by a one word header.
+constexpr size_t kObjectBytes = 2 * sizeof(long);
+
+__attribute__((noinline)) void Churn(long num_allocations) {
+  auto a = AllocateHeapObject(0);
+  auto b = AllocateHeapObject(0);
+  auto c = AllocateHeapObject(0);
+  auto d = AllocateHeapObject(0);
+
+  for (long i = 0; i < num_allocations; i++) {
+    auto garbage = AllocateHeapObject(i);
+    if (i % kReplaceInterval != 0)
+      continue;
+    // Rotate the window, so that each survivor lives for four intervals.
+    a = b;
+    b = c;
+    c = d;
+    d = garbage;
+  }
+
+  long last = (num_allocations - 1) / kReplaceInterval * kReplaceInterval;
+  if ((*d).data != last || (*c).data != last - kReplaceInterval) {
+    fprintf(stderr, "Handles corrupted\n");
+    exit(1);
+  }
+}
+
+// The function which attaches a thread must not hold roots itself, as the
+// thread's stack is only scanned up to its frame.
+__attribute__((noinline)) void ThreadMain(long num_allocations) {
+  AttachThread();
+  Churn(num_allocations);
+  DetachThread();
+}
+
+void Join(void* thread) {
+  static_cast<std::thread*>(thread)->join();
+}
+
+int main(int argc, char** argv) {
+  long num_threads = argc > 1 ? atol(argv[1]) : kDefaultThreads;
+  long num_allocations = argc > 2 ? atol(argv[2]) : kDefaultAllocations;
+  InitGC();
+
+  GCRecorder recorder;
+  recorder.Start();
+  std::vector<std::thread> threads;
+  for (long i = 0; i < num_threads; i++)
+    threads.emplace_back(ThreadMain, num_allocations);
+
+  // Joining blocks, so it must not hold up the other threads' collections.
+  for (auto& thread : threads)
+    GCBlockingCall(Join, &thread);
+  recorder.Report("churn", num_threads * num_allocations * kObjectBytes);
+
+  TeardownGC();
+  return 0;
+}
@@ -0,0 +1,67 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures the cost of scanning a deep stack in which every frame holds
+// several Handles. The bottom frame collects repeatedly, once with stack
+// barriers, which let every collection after the first skip the frames above
+// it, and once without, so that every collection walks the whole stack. The
+// Handles are checked as the stack unwinds.
+//
+// Usage: deep_recursion_benchmark [depth] [collections]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "benchmark.h"
+#include "objects.h"
+#include "tests.h"
+
+constexpr long kDefaultDepth = 2000;
+constexpr long kDefaultCollections = 50;
+constexpr size_t kHandlesPerFrame = 4;
+
+// Each object is preceded by a one word header.
+constexpr size_t kObjectBytes = 2 * sizeof(long);
+
+__attribute__((noinline)) long Recurse(long depth, long num_collections) {
+  auto a = AllocateHeapObject(depth);
+  auto b = AllocateHeapObject(depth + 1);
+  auto c = AllocateHeapObject(depth + 2);
+  auto d = AllocateHeapObject(depth + 3);
+
+  long frames = 1;
+  if (depth == 0) {
+    for (long i = 0; i < num_collections; i++)
+      GC();
+  } else {
+    frames += Recurse(depth - 1, num_collections);
+  }
+
+  if ((*a).data != depth || (*b).data != depth + 1 ||
+      (*c).data != depth + 2 || (*d).data != depth + 3) {
+    fprintf(stderr, "Handles corrupted at depth %ld\n", depth);
+    exit(1);
+  }
+  return frames;
+}
+
+void Run(const char* name, long depth, long num_collections) {
+  GCRecorder recorder;
+  recorder.Start();
+  long frames = Recurse(depth - 1, num_collections);
+  recorder.Report(name, frames * kHandlesPerFrame * kObjectBytes);
+}
+
+int main(int argc, char** argv) {
+  long depth = argc > 1 ? atol(argv[1]) : kDefaultDepth;
+  long num_collections = argc > 2 ? atol(argv[2]) : kDefaultCollections;
+  InitGC(64 << 20);
+
+  Run("deep_recursion", depth, num_collections);
+  SetGCStackBarriers(false);
+  Run("deep_recursion_no_barriers", depth, num_collections);
+
+  TeardownGC();
+  return 0;
+}
@@ -0,0 +1,109 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures the pause time of a collection with 1 to 8 GC workers. A complete
+// binary tree is built in the nursery before each collection and survives it,
+// so each pause is dominated by promoting the tree. The tree is checked after
+// each collection. The number of full collections is reported alongside, as
+// the old generation fills up with the trees of previous collections.
+//
+// Usage: gc_pause_benchmark [collections_per_worker_count]
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "gc/gc_control.h"
+#include "objects.h"
+#include "tests.h"
+
+// A tree node: left and right children, and the node's value.
+using Node = long GC_AS*;
+using NodeFields = Node GC_AS*;
+
+constexpr int kTreeDepth = 16;
+constexpr size_t kOldSpaceSize = 64 << 20;
+constexpr size_t kWorkerCounts[] = {1, 2, 4, 8};
+constexpr int kDefaultCollections = 20;
+
+__attribute__((noinline)) Node MakeTree(int depth) {
+  // Functions are only given stack maps if they hold a Handle, so the node's
+  // value is boxed in one.
+  auto value = AllocateHeapObject(depth);
+
+  Node left = depth > 0 ? MakeTree(depth - 1) : nullptr;
+  Node right = depth > 0 ? MakeTree(depth - 1) : nullptr;
+
+  long* ptr = TryAllocate(3, 2);
+  if (!ptr) {
+    GC();
+    ptr = TryAllocate(3, 2);
+    assert(ptr && "Heap too small for the tree");
+  }
+  Node node = AsManaged(ptr);
+  NodeFields fields = (NodeFields)node;
+  fields[0] = left;
+  fields[1] = right;
+  node[2] = (*value).data;
+  return node;
+}
+
+long SumTree(Node node) {
+  if (!node)
+    return 0;
+  NodeFields fields = (NodeFields)node;
+  return node[2] + SumTree(fields[0]) + SumTree(fields[1]);
+}
+
+double Percentile(std::vector<double>* samples, double percentile) {
+  std::sort(samples->begin(), samples->end());
+  size_t index = static_cast<size_t>(percentile * (samples->size() - 1));
+  return (*samples)[index];
+}
+
+__attribute__((noinline)) void RunBenchmark(int num_collections) {
+  auto depth = AllocateHeapObject(kTreeDepth);
+
+  printf("%8s %14s %14s %14s %12s %8s\n", "workers", "min ms", "median ms",
+         "max ms", "copied KB", "full");
+  for (size_t num_workers : kWorkerCounts) {
+    SetGCWorkers(num_workers);
+    // The first collection after a change starts the workers.
+    GC();
+    size_t num_full_collections = GetGCStats().num_full_collections;
+
+    std::vector<double> pauses;
+    size_t bytes_copied = 0;
+    for (int i = 0; i < num_collections; i++) {
+      // Each tree is promoted by the collection after it is built, and is
+      // garbage in the old generation by the next one.
+      Node tree = MakeTree((*depth).data);
+      long expected_sum = SumTree(tree);
+      GC();
+      pauses.push_back(GetGCStats().last_pause_ns / 1e6);
+      bytes_copied += GetGCStats().last_bytes_copied;
+      if (SumTree(tree) != expected_sum) {
+        fprintf(stderr, "Tree corrupted with %zu workers\n", num_workers);
+        exit(1);
+      }
+    }
+    num_full_collections =
+        GetGCStats().num_full_collections - num_full_collections;
+    printf("%8zu %14.3f %14.3f %14.3f %12zu %8zu\n", num_workers,
+           Percentile(&pauses, 0), Percentile(&pauses, 0.5),
+           Percentile(&pauses, 1), bytes_copied / num_collections / 1024,
+           num_full_collections);
+  }
+}
+
+int main(int argc, char** argv) {
+  int num_collections = argc > 1 ? atoi(argv[1]) : kDefaultCollections;
+  InitGC(kOldSpaceSize);
+  RunBenchmark(num_collections);
+  TeardownGC();
+  return 0;
+}
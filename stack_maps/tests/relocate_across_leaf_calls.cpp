@@ -0,0 +1,119 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file tests whether roots are still updated by a collection when the
+// calls around it are to functions which can never collect.
+//
+// Calls to leaf functions are not rewritten to statepoints, so they have no
+// stack maps. The collection below them must still find the Handle through the
+// statepoint of the call which does collect. It also checks, by counting stack
+// map records, that calls to leaves get no statepoints, and that qsort, which
+// calls back into the program, does get one.
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "objects.h"
+#include "tests.h"
+
+extern "C" const char __LLVM_StackMaps;
+
+long expected = 1234;
+long sink;
+long values[] = {3, 1, 2};
+char name[] = "leaf";
+
+// Returns the number of stack map records of |fn|, from the function entries
+// which follow the 16 byte header of the stack map section.
+uint64_t NumRecords(void (*fn)()) {
+  const char* section = &__LLVM_StackMaps;
+  uint32_t num_functions;
+  memcpy(&num_functions, section + 4, sizeof(num_functions));
+  for (uint32_t i = 0; i < num_functions; i++) {
+    const char* entry = section + 16 + i * 24;
+    uint64_t address;
+    uint64_t num_records;
+    memcpy(&address, entry, sizeof(address));
+    memcpy(&num_records, entry + 16, sizeof(num_records));
+    if (address == reinterpret_cast<uintptr_t>(fn))
+      return num_records;
+  }
+  return 0;
+}
+
+__attribute__((noinline)) long Leaf(long x) {
+  return x * 3;
+}
+
+// Mutually recursive, but neither ever collects.
+__attribute__((noinline)) long IsOdd(long x);
+__attribute__((noinline)) long IsEven(long x) {
+  return x == 0 ? 1 : IsOdd(x - 1);
+}
+__attribute__((noinline)) long IsOdd(long x) {
+  return x == 0 ? 0 : IsEven(Leaf(x) / 3 - 1);
+}
+
+__attribute__((noinline)) void Collect() {
+  GC();
+}
+
+__attribute__((noinline)) void test_relocation() {
+  auto handle = AllocateHeapObject(expected);
+  long tripled = Leaf((*handle).data);
+  assert(IsEven(tripled) && "Leaf function computed the wrong result");
+  Collect();
+  assert(Leaf((*handle).data) == tripled &&
+         "GC Objects differ across a collection");
+}
+
+int CompareLongs(const void* a, const void* b) {
+  long x = *static_cast<const long*>(a);
+  long y = *static_cast<const long*>(b);
+  return (x > y) - (x < y);
+}
+
+// The next three functions differ only in the calls made while the Handle is
+// live.
+__attribute__((noinline)) void WithoutLeafCalls() {
+  auto handle = AllocateHeapObject(expected);
+  Collect();
+  sink = (*handle).data;
+}
+
+__attribute__((noinline)) void WithLeafCalls() {
+  auto handle = AllocateHeapObject(expected);
+  sink = Leaf((*handle).data) + strlen(name);
+  Collect();
+  sink += (*handle).data;
+}
+
+__attribute__((noinline)) void WithQsort() {
+  auto handle = AllocateHeapObject(expected);
+  qsort(values, 3, sizeof(long), CompareLongs);
+  Collect();
+  sink = (*handle).data;
+}
+
+void test_statepoints() {
+  WithoutLeafCalls();
+  WithLeafCalls();
+  WithQsort();
+
+  uint64_t num_records = NumRecords(WithoutLeafCalls);
+  assert(num_records && "No stack map for a function holding a Handle");
+  assert(NumRecords(WithLeafCalls) == num_records &&
+         "A call to a leaf function was made into a statepoint");
+  assert(NumRecords(WithQsort) == num_records + 1 &&
+         "A call to qsort was not made into a statepoint");
+}
+
+int main() {
+  InitGC();
+  test_relocation();
+  test_statepoints();
+  TeardownGC();
+  return 0;
+}
@@ -0,0 +1,52 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file tests whether roots are updated when minor collections only scan
+// the frames which have run since the previous collection.
+//
+// The first collection at the bottom of a deep recursion scans every frame. As
+// the stack unwinds, each frame allocates a new object and some of them
+// collect again from a callee. Those collections stop at the stack barrier,
+// which must have moved up past every frame that returned, or the new objects
+// are lost.
+
+#include <assert.h>
+#include "gc/gc_control.h"
+#include "objects.h"
+#include "tests.h"
+
+constexpr long kDepth = 100;
+
+__attribute__((noinline)) void CollectFromCallee() {
+  GC();
+}
+
+__attribute__((noinline)) long test_relocation(long depth) {
+  auto before = AllocateHeapObject(depth);
+  if (depth == 0) {
+    GC();
+    // Nothing above this frame has run since the last collection.
+    GC();
+    assert(GetGCStats().last_frames_scanned < kDepth &&
+           "Unchanged frames were rescanned");
+    return (*before).data;
+  }
+
+  long sum = test_relocation(depth - 1);
+  auto after = AllocateHeapObject(depth);
+  if (depth % 10 == 0)
+    CollectFromCallee();
+  return sum + (*before).data + (*after).data;
+}
+
+int main() {
+  InitGC();
+
+  long sum = test_relocation(kDepth);
+  assert(sum == kDepth * (kDepth + 1) &&
+         "GC Objects differ across collections");
+
+  TeardownGC();
+  return 0;
+}
@@ -0,0 +1,73 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file tests whether live objects survive full collections, which compact
+// the old generation.
+//
+// A list of the most recent values is kept alive while older nodes are cut
+// off, so the old generation fills up with garbage interleaved with live nodes
+// until a full collection slides the live ones together. The holder, which is
+// old, points at a young object whenever a collection starts, so full
+// collections must also find the pointers from old objects into the nursery.
+
+#include <assert.h>
+#include "gc/gc_control.h"
+#include "objects.h"
+#include "tests.h"
+
+// A list node: the next node, and the node's value.
+using Node = long GC_AS*;
+using NodeFields = Node GC_AS*;
+using Holder = long GC_AS* GC_AS*;
+
+constexpr long kIterations = 5000;
+constexpr long kListLength = 16;
+
+__attribute__((noinline)) void test_relocation() {
+  // Functions are only given stack maps if they hold a Handle.
+  auto expected = AllocateHeapObject(1234);
+
+  Holder holder = (Holder)AsManaged(GCTryAllocate(1, 1));
+  Node list = nullptr;
+  for (long i = 0; i < kIterations; i++) {
+    Node node = AsManaged(GCTryAllocate(2, 1));
+    ((NodeFields)node)[0] = list;
+    node[1] = i;
+    list = node;
+
+    Node last = list;
+    for (long j = 1; j < kListLength && ((NodeFields)last)[0]; j++)
+      last = ((NodeFields)last)[0];
+    ((NodeFields)last)[0] = nullptr;
+
+    long GC_AS* young = AsManaged(GCTryAllocate(1, 0));
+    *young = i;
+    holder[0] = young;
+
+    GC();
+
+    assert(*holder[0] == i && "Young object lost across a collection");
+    Node next = list;
+    for (long value = i; next; value--) {
+      assert(next[1] == value && "List corrupted across a collection");
+      next = ((NodeFields)next)[0];
+    }
+  }
+
+  assert(GetGCStats().num_full_collections > 0 &&
+         "The old generation was never compacted");
+  assert((*expected).data == 1234 && "GC Objects differ across collections");
+}
+
+int main() {
+  // A small old generation, which only has room for a few collections' worth
+  // of promoted garbage.
+  InitGC(1 << 16);
+  SetGCWorkers(1);
+
+  test_relocation();
+
+  TeardownGC();
+  return 0;
+}
@@ -0,0 +1,44 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file tests whether a young object stored into a caller's Handle, through
+// a pointer to it, is updated by a minor collection.
+//
+// The first collection places the stack barrier above store_young, so the
+// second one does not scan test_relocation's frame. The Handle lives in that
+// frame's memory, as its address is passed down, so the second collection only
+// finds it if the stack write barrier recorded the store.
+
+#include <assert.h>
+#include "objects.h"
+#include "tests.h"
+
+__attribute__((noinline)) void store_young(Handle<HeapObject>* out,
+                                           long data) {
+  GC();
+  auto young = AllocateHeapObject(data);
+  *out = young;
+  GC();
+}
+
+__attribute__((noinline)) void test_relocation() {
+  auto expected = AllocateHeapObject(1234);
+
+  // Its first value is lost to the first collection, but is never read.
+  auto handle = AllocateHeapObject(0);
+  store_young(&handle, (*expected).data);
+
+  assert((*handle).data == (*expected).data &&
+         "Young object stored into a caller's Handle lost across a minor "
+         "collection");
+}
+
+int main() {
+  InitGC();
+
+  test_relocation();
+
+  TeardownGC();
+  return 0;
+}
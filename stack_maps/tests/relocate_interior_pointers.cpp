@@ -0,0 +1,47 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This tests whether pointers into the middle of an object, rather than to its
+// start, are updated across a collection.
+//
+// The cursor walking the array below is a derived pointer: once its object has
+// moved, it must point at the same element of the copy.
+
+#include <assert.h>
+#include "objects.h"
+#include "tests.h"
+
+constexpr long kLength = 8;
+
+__attribute__((noinline)) long test_relocation(long step) {
+  // Functions are only given stack maps if they hold a Handle.
+  auto length = AllocateHeapObject(kLength);
+
+  long GC_AS* array = AsManaged(GCTryAllocate(kLength, 0));
+  for (long i = 0; i < kLength; i++)
+    array[i] = i * i;
+
+  long sum = 0;
+  long GC_AS* end = array + (*length).data;
+  for (long GC_AS* cursor = array; cursor < end; cursor += step) {
+    // Moves the array, so both the cursor and the end of the array must be
+    // relocated relative to its new address.
+    GC();
+    sum += *cursor;
+  }
+  return sum;
+}
+
+int main() {
+  InitGC();
+
+  long expected = 0;
+  for (long i = 0; i < kLength; i += 2)
+    expected += i * i;
+  assert(test_relocation(2) == expected &&
+         "Interior pointers differ across a collection");
+
+  TeardownGC();
+  return 0;
+}
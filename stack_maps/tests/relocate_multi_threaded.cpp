@@ -0,0 +1,55 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This tests whether on-stack roots of every thread are updated when any
+// thread collects.
+//
+// Each thread allocates enough garbage to fill the heap many times over, so
+// collections are triggered by all of them, and the others are stopped by
+// their safepoint polls while their allocation loops are running.
+
+#include <assert.h>
+#include <thread>
+#include <vector>
+#include "objects.h"
+#include "tests.h"
+
+constexpr int kNumThreads = 4;
+constexpr long kNumAllocations = 100000;
+
+__attribute__((noinline)) void test_relocation(long expected) {
+  auto handle = AllocateHeapObject(expected);
+
+  for (long i = 0; i < kNumAllocations; i++)
+    AllocateHeapObject(i);
+
+  assert((*handle).data == expected && "GC Objects differ across a collection");
+}
+
+// The function which attaches a thread must not hold roots itself, as the
+// thread's stack is only scanned up to its frame.
+__attribute__((noinline)) void thread_main(long expected) {
+  AttachThread();
+  test_relocation(expected);
+  DetachThread();
+}
+
+void join(void* thread) {
+  static_cast<std::thread*>(thread)->join();
+}
+
+int main() {
+  InitGC(1 << 16);
+
+  std::vector<std::thread> threads;
+  for (long i = 0; i < kNumThreads; i++)
+    threads.emplace_back(thread_main, 1000 + i);
+
+  // Joining blocks, so it must not hold up the other threads' collections.
+  for (auto& thread : threads)
+    GCBlockingCall(join, &thread);
+
+  TeardownGC();
+  return 0;
+}
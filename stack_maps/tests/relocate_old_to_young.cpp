@@ -0,0 +1,42 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file tests whether a pointer from an old object into the nursery is
+// updated by a minor collection.
+//
+// The holder is promoted by the first collection. The young object stored into
+// it afterwards is only reachable through the holder, so the second
+// collection only finds it if the write barrier recorded the store.
+
+#include <assert.h>
+#include "objects.h"
+#include "tests.h"
+
+using Holder = long GC_AS* GC_AS*;
+
+__attribute__((noinline)) void test_relocation() {
+  // Functions are only given stack maps if they hold a Handle.
+  auto expected = AllocateHeapObject(1234);
+
+  Holder holder = (Holder)AsManaged(GCTryAllocate(1, 1));
+  GC();
+
+  long GC_AS* young = AsManaged(GCTryAllocate(1, 0));
+  *young = (*expected).data;
+  holder[0] = young;
+
+  GC();
+
+  assert(*holder[0] == (*expected).data &&
+         "Young object lost across a minor collection");
+}
+
+int main() {
+  InitGC();
+
+  test_relocation();
+
+  TeardownGC();
+  return 0;
+}
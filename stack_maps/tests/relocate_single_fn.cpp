@@ -22,7 +22,7 @@ __attribute__((noinline)) void test_relocation() {
   auto expected = 1234;
   auto handle = AllocateHeapObject(expected);
 
-  // Relocates all objects in the heap from fromspace to tospace and walks the
+  // Relocates all objects in the nursery to the old generation and walks the
   // stack, updating roots to point to the relocated object.
   GC();
 
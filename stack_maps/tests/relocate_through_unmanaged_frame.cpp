@@ -0,0 +1,57 @@
+// Copyright 2026 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file tests whether roots are updated through a frame which has no roots,
+// in code built without frame pointers.
+//
+// Helper holds no Handle, but it calls a function which collects, so it is
+// given stack map records anyway, which tell the walker the size of its frame
+// and which callee-saved registers it saved. It keeps six values live across
+// the call, so with -fomit-frame-pointer it saves all six callee-saved
+// registers, the one test_relocation keeps its Handle in among them. That
+// Handle is the only managed pointer live across the call to Helper, so it is
+// kept in a register rather than spilled, and is only found through Helper's
+// save slot.
+
+#include <assert.h>
+#include "objects.h"
+#include "tests.h"
+
+long expected = 1234;
+
+__attribute__((noinline)) long CollectWithHandle(long x) {
+  auto handle = AllocateHeapObject(x);
+  GC();
+  return (*handle).data;
+}
+
+// Read through a volatile, so that the values Helper keeps cannot be
+// recomputed after its call.
+volatile long seed = 2;
+
+// Has no Handle, and so no roots.
+__attribute__((noinline)) long Helper(long x) {
+  long a = seed + x;
+  long b = seed;
+  long c = seed;
+  long d = seed;
+  long e = seed;
+  long f = seed;
+  return CollectWithHandle(a) + a + b + c + d + e + f;
+}
+
+__attribute__((noinline)) void test_relocation() {
+  auto handle = AllocateHeapObject(expected);
+  long result = Helper(1);
+  assert(result == 16 && "Wrong result through an unmanaged frame");
+  assert((*handle).data == expected &&
+         "GC Objects differ across a collection through an unmanaged frame");
+}
+
+int main() {
+  InitGC();
+  test_relocation();
+  TeardownGC();
+  return 0;
+}
@@ -22,82 +22,106 @@ class StackMapTest(plugin_testing.ClangPluginTest):
   """Test harness for stack map artefact."""
 
   def __init__(self, test_base, llvm_bin_path, libgc_path, ident_sp_pass_path,
-               reg_gc_pass_path,):
+               reg_gc_pass_path, safepoint_index_tool_path=None,
+               run_benchmarks=False, omit_frame_pointer=False, lto=None):
     self._test_base = test_base
     self._llvm_bin_path = llvm_bin_path
     self._libgc_path = libgc_path
     self._ident_sp_pass_path = ident_sp_pass_path
     self._reg_gc_pass_path = reg_gc_pass_path
+    self._safepoint_index_tool_path = safepoint_index_tool_path
+    self._run_benchmarks = run_benchmarks
+    self._omit_frame_pointer = omit_frame_pointer
+    self._lto = lto
 
     self._clang_path = os.path.join(llvm_bin_path, 'clang++')
-    self._opt_path = os.path.join(llvm_bin_path, 'opt')
-    self._llc_path = os.path.join(llvm_bin_path, 'llc')
     self._out_dir = os.path.join(
         os.path.dirname(os.path.realpath(__file__)), 'out')
 
   def build_commands(self, test_name):
-      ll_filename = os.path.join(self._out_dir, "%s.ll" % test_name)
-      ll_with_gc_filename = os.path.join(
-          self._out_dir, "%s_optimised.ll" % test_name)
-      asm_filename = os.path.join(self._out_dir, "%s.s" % test_name)
       obj_filename = os.path.join(self._out_dir, "%s.o" % test_name)
       bin_name = os.path.join(self._out_dir, "%s.out" % test_name)
 
-      # Run the clang++ frontend with -O2 but stop after emitting the IR. There
-      # is a bug in clang which prevents us from running GC related IR phases
-      # directly from the frontend and requires us to split it into multiple
-      # build phases.
+      # Compile with both pass plugins loaded into clang's pass pipeline. The
+      # first selects which functions will be safepointed at the start of the
+      # pipeline. The second runs once the optimiser is done: it marks those
+      # functions as using the GC, inserts write barriers after stores of
+      # managed pointers into the heap, inserts safepoint polls so that their
+      # threads stop promptly when another thread collects, and inserts
+      # statepoint relocation sequences, which end up in stack maps being
+      # generated during the lowering phase.
+      #
+      # Derived pointers are always relocated rather than recomputed from their
+      # relocated base, so that the tests exercise their stack map entries. GC
+      # pointers are allowed to stay in callee-saved registers across
+      # statepoints rather than always being spilled, which the walker
+      # relocates through the GC shim's register file.
+      #
+      # Without frame pointers, the walker steps over frames by the sizes
+      # recorded in the stack maps, and RBP can hold roots too.
+      #
+      # The walker finds which callee-saved registers a frame saved by decoding
+      # the pushes at the entry of its function, so prologues must not be
+      # shrink-wrapped into later blocks. The plugin turns shrink-wrapping off
+      # where it runs, but a full LTO link generates code without it.
+      if self._omit_frame_pointer:
+        frame_pointer_flag = '-fomit-frame-pointer'
+      else:
+        frame_pointer_flag = '-fno-omit-frame-pointer'
+      llvm_flags = [
+          '-spp-rematerialization-threshold=0',
+          '--max-registers-for-gc-values=4',
+          '--fixup-allow-gcptr-in-csr',
+          '--enable-shrink-wrap=false',
+      ]
       clang_cmd = [
           self._clang_path,
-          '-std=c++14',
-          '-fno-omit-frame-pointer',
+          '-std=c++17',
+          frame_pointer_flag,
           '-I../',
-          '-Xclang',
-          '-load',
-          '-Xclang',
-          self._ident_sp_pass_path,
           '-O2',
-          '-S',
-          '-emit-llvm',
-          '-o', ll_filename,
-          '%s.cpp' % test_name
+          '-fpass-plugin=%s' % self._ident_sp_pass_path,
+          '-fpass-plugin=%s' % self._reg_gc_pass_path,
       ]
+      for flag in llvm_flags:
+        clang_cmd += ['-mllvm', flag]
 
-      # Run two passes on the IR. The first selects which functions will be
-      # safepointed, the second inserts statepoint relocation sequences and ends
-      # up in stack maps being generated during the lowering phase.
-      opt_cmd = [
-          self._opt_path,
-          '-load=%s' % self._reg_gc_pass_path,
-          '-register-gc-fns',
-          '-rewrite-statepoints-for-gc',
-          '-S',
-          '-o', ll_with_gc_filename,
-          ll_filename
-      ]
+      # A test which needs more flags lists them in a .flags file, whose flags
+      # override the ones above.
+      flags_filename = '%s.flags' % test_name
+      if os.path.exists(flags_filename):
+        with open(flags_filename) as f:
+          clang_cmd += f.read().split()
+      cmds = []
 
-      # Note: We must ensure each stage of lowering disables omit frame pointer
-      # optimisation
-      llc_cmd = [
-          self._llc_path,
-          ll_with_gc_filename,
-          '--frame-pointer=all',
-          '-o',
-          asm_filename
-      ]
-
-      # The next two stages are required because ToT LLVM emits stackmaps which
-      # are local only to their object file. In a somewhat hacky fix, we
-      # globalise this symbol so that it can be used by the independent GC
-      # runtime library.
-      make_native = [
-          self._clang_path,
-          '-c',
-          '-o',
-          obj_filename,
-          asm_filename,
-      ]
+      # With LTO the compile only emits bitcode, and a relocatable link runs
+      # the LTO backend, so that the object which comes out of it holds the
+      # stack maps, for objcopy below. With ThinLTO the statepoints are
+      # inserted by the backend, which needs the plugin loaded. With full LTO
+      # they are inserted by the compile, and the backend only lowers them.
+      compile_filename = obj_filename
+      if self._lto:
+        compile_filename = os.path.join(self._out_dir, "%s.bc" % test_name)
+        lto_flag = '-flto=thin' if self._lto == 'thin' else '-flto'
+        clang_cmd.append(lto_flag)
+        lto_cmd = [
+            self._clang_path,
+            lto_flag,
+            '-fuse-ld=lld',
+            '-nostdlib',
+            '-r',
+        ]
+        if self._lto == 'thin':
+          lto_cmd.append('-Wl,--load-pass-plugin=%s' % self._reg_gc_pass_path)
+        for flag in llvm_flags:
+          lto_cmd.append('-Wl,-mllvm,%s' % flag)
+        lto_cmd += ['-o', obj_filename, compile_filename]
+        cmds = [lto_cmd]
+      clang_cmd += ['-c', '-o', compile_filename, '%s.cpp' % test_name]
 
+      # LLVM emits stackmaps which are local only to their object file. In a
+      # somewhat hacky fix, we globalise this symbol so that it can be used by
+      # the independent GC runtime library.
       obj_copy = [
           'objcopy',
           '--globalize-symbol=__LLVM_StackMaps',
@@ -108,23 +132,41 @@ class StackMapTest(plugin_testing.ClangPluginTest):
       link_cmd = [
           self._clang_path,
           obj_filename,
-          '-fno-omit-frame-pointer',
+          '-pthread',
           self._libgc_path,
           '-o',
           bin_name
       ]
 
-      run_cmd = ['%s' % bin_name]
-      return [
-          clang_cmd,
-          opt_cmd,
-          llc_cmd,
-          make_native,
+      cmds = [clang_cmd] + cmds + [
           obj_copy,
           link_cmd,
-          run_cmd
       ]
 
+      # Optionally precompute the safepoint index and embed it in the binary,
+      # so that the runtime maps it instead of parsing the stackmap section.
+      # The alignment can only be set once the section exists.
+      if self._safepoint_index_tool_path:
+        index_filename = os.path.join(self._out_dir, "%s.gcidx" % test_name)
+        cmds += [
+            [self._safepoint_index_tool_path, bin_name, index_filename],
+            [
+                'objcopy',
+                '--add-section',
+                '.gc_safepoints=%s' % index_filename,
+                bin_name
+            ],
+            [
+                'objcopy',
+                '--set-section-alignment',
+                '.gc_safepoints=8',
+                bin_name
+            ],
+        ]
+
+      run_cmd = ['%s' % bin_name]
+      return cmds + [run_cmd]
+
   def Run(self):
     """Runs the tests.
 
@@ -164,8 +206,33 @@ class StackMapTest(plugin_testing.ClangPluginTest):
         len(passing) + len(failing), len(passing), len(failing)))
     for test in failing:
       print('    %s' % test)
+
+    if self._run_benchmarks:
+      return len(failing) + self.RunBenchmarks()
     return len(failing)
 
+  def RunBenchmarks(self):
+    """Builds each benchmark like a test, and prints what it reports.
+
+    Returns: the number of benchmarks which failed to build or run.
+    """
+    os.mkdir(os.path.join(self._out_dir, 'benchmarks'))
+    num_failing = 0
+    for benchmark in sorted(glob.glob('benchmarks/*.cpp')):
+      print('Running %s...' % benchmark)
+      benchmark_name, _ = os.path.splitext(benchmark)
+
+      cmds = self.build_commands(benchmark_name)
+      try:
+        for cmd in cmds[:-1]:
+          subprocess.check_output(cmd, stderr=subprocess.STDOUT)
+        output = subprocess.check_output(cmds[-1], stderr=subprocess.STDOUT)
+        print(output.decode())
+      except subprocess.CalledProcessError as e:
+        print('\tfailed: %s' % e.output.decode())
+        num_failing += 1
+    return num_failing
+
   def RunOneTest(self, test_name, cmds):
     for cmd in cmds:
       try:
@@ -189,9 +256,23 @@ def main():
       'llvm_bin_path', help='The path to the llvm tools bin dir.')
   parser.add_argument('libgc_path', help='The path to the runtime gc library.')
   parser.add_argument('identify_safepoints_path',
-    help='The path to the identify safepoints IR pass.')
+    help='The path to the identify safepoints pass plugin.')
   parser.add_argument('reg_gc_fns_path',
-    help='The path to the register GC functions IR pass.')
+    help='The path to the register GC functions pass plugin.')
+  parser.add_argument('--safepoint-index-tool',
+    help='The path to gen_safepoint_index. When given, each test binary '
+    'carries a precomputed safepoint index.')
+  parser.add_argument('--benchmarks', action='store_true',
+    help='Also build and run the benchmarks in benchmarks/ after the tests.')
+  parser.add_argument('--omit-frame-pointer', action='store_true',
+    help='Build the tests without frame pointers.')
+  lto = parser.add_mutually_exclusive_group()
+  lto.add_argument('--thin-lto', action='store_const', dest='lto',
+    const='thin', help='Build the tests with ThinLTO, which inserts the '
+    'statepoints at link time.')
+  lto.add_argument('--full-lto', action='store_const', dest='lto',
+    const='full', help='Build the tests with full LTO, which inserts the '
+    'statepoints before linking.')
   args = parser.parse_args()
 
   return StackMapTest(
@@ -200,6 +281,10 @@ def main():
       args.libgc_path,
       args.identify_safepoints_path,
       args.reg_gc_fns_path,
+      args.safepoint_index_tool,
+      args.benchmarks,
+      args.omit_frame_pointer,
+      args.lto,
       ).Run()
 
 if __name__ == '__main__':